@@ -407,6 +407,9 @@ raddi::proof::threadpool threadpool (raddi::proof::threadpool default_ = raddi::
         } else
         if (!std::wcscmp (parameter, L"custom")) {
             return raddi::proof::threadpool::custom;
+        } else
+        if (!std::wcscmp (parameter, L"portable")) {
+            return raddi::proof::threadpool::portable;
         } else {
             raddi::log::error (0x24, parameter);
         }
@@ -570,7 +573,12 @@ int wmain (int argc, wchar_t ** argw) {
     }
 
     SetLastError (0);
-    if (go ()) {
+    const auto success = go ();
+
+    // solver memory is kept for subsequent proofs, there won't be any
+    raddi::proof::trim ();
+
+    if (success) {
         return ERROR_SUCCESS;
     } else {
         auto result = GetLastError ();
@@ -588,6 +596,8 @@ int wmain (int argc, wchar_t ** argw) {
 
 bool benchmark (const wchar_t *);
 bool database_verification ();
+bool database_export (const wchar_t * path);
+bool database_import (const wchar_t * path);
 bool hash (const wchar_t *);
 bool prove (const wchar_t *);
 bool aead_benchmark (const wchar_t *);
@@ -703,6 +713,16 @@ bool go () {
         return database_verification ();
     }
 
+    // export/import
+    //  - portable database snapshot, see raddi_database_snapshot.cpp
+
+    if (auto parameter = command (argc, argw, L"export")) {
+        return database_export (parameter);
+    }
+    if (auto parameter = command (argc, argw, L"import")) {
+        return database_import (parameter);
+    }
+
     // benchmark
     //  - measures how long it takes to find predetermined solution
 
@@ -1448,37 +1468,42 @@ bool list (const wchar_t * parent_) {
     }
     std::printf ("\n");
 
-    database.data->select (oldest, latest,
-                           [parent, author] (const auto & row, const auto &) {
-                                return row.parent == parent
-                                    && (author.isnull () || row.id.identity == author);
-                           },
-                           [&columns, names] (const auto & row, const auto & detail) {
-                                std::printf (columns [0].format, columns [0].width, row.id.serialize ().c_str ());
-                                std::printf (columns [1].format, columns [1].width, detail.shard);
-                                std::printf (columns [2].format, columns [2].width, detail.index + 1);
-                                std::printf (columns [3].format, columns [3].width, detail.count);
-                                std::printf (columns [4].format, columns [4].width, row.data.offset);
-                                std::printf (columns [5].format, columns [5].width, row.data.length + sizeof (raddi::entry::signature));
-                                if (names) {
-                                    return true;
-                                } else {
-                                    std::printf ("\n");
-                                    return false;
-                                }
-                            },
-                           [&columns] (const auto & row, const auto &, std::uint8_t * raw) {
-                                const auto entry = reinterpret_cast <raddi::entry *> (raw);
-
-                                std::size_t size = row.data.length;
-                                std::size_t proof_size = 0;
-                                if (entry->proof (size + sizeof (raddi::entry), &proof_size)) {
-                                    std::printf (" ");
-                                    analyze (entry->content (), size - proof_size, true);
-                                    std::printf ("\n");
-                                } else
-                                    raddi::log::stop (0x21, row.id);
-                            });
+    auto constrain = [parent, author] (const auto & row, const auto &) {
+        return row.parent == parent
+            && (author.isnull () || row.id.identity == author);
+    };
+    auto query = [&columns, names] (const auto & row, const auto & detail) {
+        std::printf (columns [0].format, columns [0].width, row.id.serialize ().c_str ());
+        std::printf (columns [1].format, columns [1].width, detail.shard);
+        std::printf (columns [2].format, columns [2].width, detail.index + 1);
+        std::printf (columns [3].format, columns [3].width, detail.count);
+        std::printf (columns [4].format, columns [4].width, row.data.offset);
+        std::printf (columns [5].format, columns [5].width, row.data.length + sizeof (raddi::entry::signature));
+        if (names) {
+            return true;
+        } else {
+            std::printf ("\n");
+            return false;
+        }
+    };
+    auto callback = [&columns] (const auto & row, const auto &, std::uint8_t * raw) {
+        const auto entry = reinterpret_cast <raddi::entry *> (raw);
+
+        std::size_t size = row.data.length;
+        std::size_t proof_size = 0;
+        if (entry->proof (size + sizeof (raddi::entry), &proof_size)) {
+            std::printf (" ");
+            analyze (entry->content (), size - proof_size, true);
+            std::printf ("\n");
+        } else
+            raddi::log::stop (0x21, row.id);
+    };
+
+    if (author.isnull ()) {
+        database.data->select (oldest, latest, constrain, query, callback);
+    } else {
+        database.data->select ({ raddi::db::secondary::identity }, author, oldest, latest, constrain, query, callback);
+    }
     return true;
 }
 
@@ -2115,7 +2140,7 @@ bool get (const wchar_t * what) {
         return raddi::log::error (0x19, eid);
 }
 
-bool database_verification () {
+bool database_export (const wchar_t * path) {
     raddi::instance instance (option (argc, argw, L"instance"));
     if (instance.status != ERROR_SUCCESS)
         return raddi::log::data (0x91);
@@ -2124,153 +2149,76 @@ bool database_verification () {
     if (!database.connected ())
         return raddi::log::error (0x92, instance.get <std::wstring> (L"database"));
 
-    struct : public raddi::entry {
-        std::uint8_t description [raddi::entry::max_content_size];
-    } parent;
-    struct : public raddi::entry {
-        std::uint8_t description [raddi::entry::max_content_size];
-    } suspect;
-    struct : public raddi::identity {
-        std::uint8_t description [raddi::identity::max_description_size];
-    } identity;
+    std::uint32_t oldest = 0;
+    std::uint32_t latest = raddi::now ();
 
-    // validate identities
-    //  - TODO: improve reporting, use raddi::log
+    if (auto p = option (argc, argw, L"oldest")) {
+        oldest = std::wcstoul (p, nullptr, 16);
+    }
+    if (auto p = option (argc, argw, L"latest")) {
+        latest = std::wcstoul (p, nullptr, 16);
+    }
 
-    database.identities->select (
-        0, raddi::now (),
-        [&database, &identity] (const auto & row, const auto & detail) {
-            printf ("IDENTITY %ls: ", row.id.serialize ().c_str ());
+    auto n = database.export_snapshot (path, oldest, latest);
+    if (n != (std::size_t) -1) {
+        std::printf ("%zu entries exported\n", n);
+        return true;
+    } else
+        return false;
+}
 
-            std::size_t identity_size;
-            if (database.get (row.id, &identity, &identity_size)) {
+bool database_import (const wchar_t * path) {
 
-                if (identity.validate (&identity, identity_size)) {
-                    if (identity.verify (identity_size, identity.public_key)) {
-                        printf ("OK\n");
-                    } else {
-                        printf ("DOES NOT VERIFY\n");
-                    }
-                } else {
-                    printf ("DOES NOT VALIDATE\n");
-                }
-            } else
-                raddi::log::error (0x17, identity.id.serialize ());
+    // importing requires exclusive (writer) access, the node must not be running on the database
 
-            return false;
-        },
-        [] (const auto &, const auto & detail) { return false; },
-        [] (const auto &, const auto & detail, std::uint8_t *) {});
+    std::wstring directory;
+    if (auto parameter = option (argc, argw, L"database")) {
+        directory = parameter;
+    } else {
+        raddi::instance instance (option (argc, argw, L"instance"));
+        if (instance.status != ERROR_SUCCESS)
+            return raddi::log::data (0x91);
 
-    // validate channels
+        directory = instance.get <std::wstring> (L"database");
+    }
 
-    database.channels->select (
-        0, raddi::now (),
-        [&database, &identity, &suspect] (const auto & row, const auto & detail) {
-            printf ("CHANNEL %ls: ", row.id.serialize ().c_str ());
+    raddi::db database (file::access::write, directory);
+    if (!database.connected ())
+        return raddi::log::error (0x92, directory);
 
-            std::size_t identity_size;
-            std::size_t suspect_size;
-            if (!database.get (row.id.identity, &identity, &identity_size)) {
-                printf ("IDENTITY %ls DOES NOT EXIST\n", row.id.identity.serialize ().c_str ());
-                return false;
-            }
-            if (!database.get (row.id, &suspect, &suspect_size)) {
-                printf ("DOES NOT EXIST\n");
-                return false;
-            }
+    auto n = database.import_snapshot (path);
+    std::printf ("%zu entries imported\n", n);
+    return true;
+}
 
-            if (suspect.validate (&suspect, suspect_size)) {
-                if (suspect.verify (suspect_size, identity.public_key)) {
-                    printf ("OK\n");
-                } else {
-                    printf ("DOES NOT VERIFY\n");
-                }
-            } else {
-                printf ("DOES NOT VALIDATE\n");
-            }
+bool database_verification () {
+    bool repair = false;
+    unsigned int threads = 0;
 
-            return false;
-        },
-        [] (const auto &, const auto & detail) { return false; },
-        [] (const auto &, const auto & detail, std::uint8_t *) {});
-
-    // validate threads
-
-    database.threads->select (
-        0, raddi::now (),
-        [&database, &identity, &parent, &suspect] (const auto & row, const auto & detail) {
-            printf ("THREAD %ls: ", row.id.serialize ().c_str ());
-
-            std::size_t identity_size;
-            std::size_t suspect_size;
-            std::size_t parent_size;
-            if (!database.get (row.id.identity, &identity, &identity_size)) {
-                printf ("IDENTITY %ls DOES NOT EXIST\n", row.id.identity.serialize ().c_str ());
-                return false;
-            }
-            if (!database.get (row.parent, &parent, &parent_size)) {
-                printf ("PARENT DOES NOT EXIST\n");
-                return false;
-            }
-            if (!database.get (row.id, &suspect, &suspect_size)) {
-                printf ("DOES NOT EXIST\n");
-                return false;
-            }
+    option (argc, argw, L"repair", repair);
+    option (argc, argw, L"threads", threads);
 
-            if (suspect.validate (&suspect, suspect_size)) {
-                if (suspect.verify (suspect_size, identity.public_key)) {
-                    printf ("OK\n");
-                } else {
-                    printf ("DOES NOT VERIFY\n");
-                }
-            } else {
-                printf ("DOES NOT VALIDATE\n");
-            }
+    // repair requires exclusive (writer) access, the node must not be running on the database
 
-            return false;
-        },
-        [] (const auto &, const auto & detail) { return false; },
-        [] (const auto &, const auto & detail, std::uint8_t *) {});
+    std::wstring directory;
+    if (auto parameter = option (argc, argw, L"database")) {
+        directory = parameter;
+    } else {
+        raddi::instance instance (option (argc, argw, L"instance"));
+        if (instance.status != ERROR_SUCCESS)
+            return raddi::log::data (0x91);
 
-    // validate data
-        
-    database.data->select (
-        0, raddi::now (),
-        [&database, &identity, &parent, &suspect] (const auto & row, const auto & detail) {
-            printf ("ENTRY %ls: ", row.id.serialize ().c_str ());
-
-            std::size_t identity_size;
-            std::size_t suspect_size;
-            std::size_t parent_size;
-            if (!database.get (row.id.identity, &identity, &identity_size)) {
-                printf ("IDENTITY %ls DOES NOT EXIST\n", row.id.identity.serialize ().c_str ());
-                return false;
-            }
-            if (!database.get (row.parent, &parent, &parent_size)) {
-                printf ("PARENT DOES NOT EXIST\n");
-                return false;
-            }
-            if (!database.get (row.id, &suspect, &suspect_size)) {
-                printf ("DOES NOT EXIST\n");
-                return false;
-            }
+        directory = instance.get <std::wstring> (L"database");
+    }
 
-            if (suspect.validate (&suspect, suspect_size)) {
-                if (suspect.verify (suspect_size, identity.public_key)) {
-                    printf ("OK\n");
-                } else {
-                    printf ("DOES NOT VERIFY\n");
-                }
-            } else {
-                printf ("DOES NOT VALIDATE\n");
-            }
+    raddi::db database (repair ? file::access::write : file::access::read, directory);
+    if (!database.connected ())
+        return raddi::log::error (0x92, directory);
 
-            return false;
-        },
-        [] (const auto &, const auto & detail) { return false; },
-        [] (const auto &, const auto & detail, std::uint8_t *) {});
+    const auto result = database.verify (repair, threads);
 
+    std::printf ("%zu shards, %zu entries verified\n", result.shards, result.rows);
+    std::printf ("%zu invalid, %zu repaired\n", result.invalid, result.repaired);
     return true;
 }
 
@@ -2464,6 +2412,7 @@ bool benchmark (const wchar_t * parameter) {
     opts.threadpool = threadpool ();
     opts.requirements.time = 0;
     opts.parameters.parallelism = 0;
+    option (argc, argw, L"threadpool-affinity", opts.affinity);
 
     std::uint32_t count = 1;
     option (argc, argw, L"count", count);
@@ -2644,6 +2593,7 @@ bool prove (const wchar_t * parameter) {
     opts.requirements.complexity = 0;
     opts.requirements = complexity (opts.requirements);
     opts.threadpool = threadpool ();
+    option (argc, argw, L"threadpool-affinity", opts.affinity);
 
     auto first = raddi::proof::min_complexity;
     auto last = raddi::proof::max_complexity;
@@ -65,6 +65,14 @@ std::uintmax_t file::size () const noexcept {
         return (std::uintmax_t) -1;
 }
 
+std::uint64_t file::identity () const noexcept {
+    BY_HANDLE_FILE_INFORMATION information;
+    if (GetFileInformationByHandle (*this, &information))
+        return ((std::uint64_t) information.nFileIndexHigh << 32) | information.nFileIndexLow;
+    else
+        return 0;
+}
+
 bool file::resize (std::uintmax_t length) noexcept {
     return this->seek (length) != (std::uintmax_t) -1
         && SetEndOfFile (*this);
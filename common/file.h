@@ -13,6 +13,8 @@
 class file {
     std::int32_t handle = 0;
 
+    friend class mapping;
+
 public:
     enum class access : DWORD {
         query = FILE_READ_ATTRIBUTES,
@@ -30,6 +32,7 @@ public:
         random = FILE_FLAG_RANDOM_ACCESS,
         temporary = FILE_ATTRIBUTE_TEMPORARY,
         sequential = FILE_FLAG_SEQUENTIAL_SCAN,
+        write_through = FILE_FLAG_WRITE_THROUGH | FILE_FLAG_SEQUENTIAL_SCAN, // journals
     };
     enum class mode {
         open = OPEN_EXISTING,
@@ -94,6 +97,12 @@ public:
     //
     std::uintmax_t size () const noexcept;
 
+    // identity
+    //  - returns number identifying the file on its volume, 0 on failure
+    //  - used to detect that path now refers to different file (replaced by rename)
+    //
+    std::uint64_t identity () const noexcept;
+
     // resize
     //  - truncates or zero-fills file to make it length-bytes long
     //
@@ -185,6 +194,7 @@ inline std::wstring translate (enum class file::buffer b, const std::wstring &)
         case file::buffer::random: return L"random access";
         case file::buffer::sequential: return L"sequential scan";
         case file::buffer::temporary: return L"temporary file";
+        case file::buffer::write_through: return L"write-through";
     }
     return std::to_wstring ((int) b);
 }
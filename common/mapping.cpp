@@ -0,0 +1,31 @@
+#include "mapping.h"
+
+bool mapping::map (const file & f) noexcept {
+    this->close ();
+
+    if (f.closed ())
+        return false;
+
+    const auto n = f.size ();
+    if ((n == 0) || (n == (std::uintmax_t) -1) || (n > (std::uintmax_t) SIZE_MAX))
+        return false;
+
+    if (auto section = CreateFileMapping (f, NULL, PAGE_READONLY, 0, 0, NULL)) {
+        this->view = static_cast <const std::uint8_t *> (MapViewOfFile (section, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle (section); // view keeps the section alive
+    }
+
+    if (this->view) {
+        this->length = n;
+        return true;
+    } else
+        return false;
+}
+
+void mapping::close () noexcept {
+    if (this->view) {
+        UnmapViewOfFile (this->view);
+        this->view = nullptr;
+        this->length = 0;
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef RADDI_MAPPING_H
+#define RADDI_MAPPING_H
+
+#include "file.h"
+#include <cstdint>
+#include <cstring>
+
+// mapping
+//  - read-only memory-mapped view of whole 'file' as it was at the time of 'map'
+//  - data appended to the file later are not visible until 'map' is called again
+//  - CreateFileMapping/MapViewOfFile over 'file' handle, implementation in 'mapping.cpp'
+//  - NOTE: on Windows file cannot be truncated while mapped, 'close' before 'resize'
+//
+class mapping {
+    const std::uint8_t * view = nullptr;
+    std::uintmax_t       length = 0;
+
+public:
+    mapping () = default;
+    mapping (mapping && other) noexcept : view (other.view), length (other.length) {
+        other.view = nullptr;
+        other.length = 0;
+    }
+    mapping & operator = (mapping && other) noexcept {
+        this->close ();
+        this->view = other.view;
+        this->length = other.length;
+        other.view = nullptr;
+        other.length = 0;
+        return *this;
+    }
+    ~mapping () {
+        this->close ();
+    }
+
+    // map
+    //  - (re)maps all current content of the 'file', releasing previous view
+    //  - returns false on failure or if the file is empty, mapping is closed then
+    //
+    bool map (const file &) noexcept;
+
+    // close
+    //  - releases the view
+    //
+    void close () noexcept;
+    bool closed () const noexcept { return this->view == nullptr; }
+
+    // size
+    //  - number of bytes of the file accessible through the view
+    //
+    std::uintmax_t size () const noexcept { return this->length; }
+
+    // data
+    //  - returns pointer to the 'offset' of the file, if 'length' bytes are available there
+    //  - returns nullptr if the range is not covered by the view
+    //
+    const std::uint8_t * data (std::uintmax_t offset, std::size_t length) const noexcept {
+        if (this->view && (offset <= this->length) && (length <= this->length - offset))
+            return this->view + offset;
+        else
+            return nullptr;
+    }
+
+    // read
+    //  - copies 'length' bytes at 'offset' into the 'buffer'
+    //  - returns false if the range is not covered by the view, caller then falls back to 'file::read'
+    //
+    bool read (std::uintmax_t offset, void * buffer, std::size_t length) const noexcept {
+        if (auto p = this->data (offset, length)) {
+            std::memcpy (buffer, p, length);
+            return true;
+        } else
+            return false;
+    }
+
+    template <typename T>
+    bool read (std::uintmax_t offset, T & object) const noexcept {
+        return this->read (offset, &object, sizeof object);
+    }
+
+private:
+    mapping (const mapping &) = delete;
+    mapping & operator = (const mapping &) = delete;
+};
+
+#endif
@@ -4,9 +4,12 @@
 #include "../common/log.h"
 #include "../node/server.h"
 #include <vector>
+#include <atomic>
 
 // Monitor
-//  - 
+//  - watches directory for new, changed, renamed and removed files
+//  - ReadDirectoryChangesW completed on the server's I/O completion port
+//  - derived class must 'stop' the monitor in its destructor, completion may call 'process'
 //  - log codes used:
 //     - notes: 1, 2, 3
 //     - events: 2, 3
@@ -19,7 +22,7 @@ class Monitor
 
     HANDLE directory;
 
-    bool active = false;
+    std::atomic <bool> active { false }; // cleared by 'stop' while completion may be running
     bool retry = false;
 
     std::vector <unsigned char> buffer;
@@ -36,7 +39,8 @@ protected:
     virtual std::wstring render_directory_path () const = 0;
 
     // process
-    //  - passes name of a file that has appeared/changed to user for processing
+    //  - passes name of a file that has appeared/changed/was removed to user for processing
+    //  - returning false requests the directory to be rescanned later
     //
     virtual bool process (const std::wstring & filename) = 0;
 
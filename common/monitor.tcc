@@ -87,7 +87,8 @@ void Monitor <LogProviderComponent>::completion (bool success, std::size_t n) {
 
                     auto p = reinterpret_cast <FILE_NOTIFY_INFORMATION *> (&this->buffer [0]);
                     do {
-                        if (p->Action == FILE_ACTION_ADDED || p->Action == FILE_ACTION_MODIFIED) {
+                        if (p->Action == FILE_ACTION_ADDED || p->Action == FILE_ACTION_MODIFIED
+                                || p->Action == FILE_ACTION_RENAMED_NEW_NAME || p->Action == FILE_ACTION_REMOVED) {
                             files.emplace (p->FileName, p->FileNameLength / sizeof (wchar_t));
                         }
                         p = reinterpret_cast <FILE_NOTIFY_INFORMATION *> (reinterpret_cast <unsigned char *> (p) + p->NextEntryOffset);
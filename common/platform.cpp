@@ -11,6 +11,7 @@ namespace {
     BOOL (WINAPI * ptrSetThreadGroupAffinity) (HANDLE, const GROUP_AFFINITY *, PGROUP_AFFINITY) = NULL;
     BOOL (WINAPI * ptrSetThreadIdealProcessorEx) (HANDLE, PPROCESSOR_NUMBER, PPROCESSOR_NUMBER) = NULL;
     BOOL (WINAPI * ptrGetLogicalProcessorInformationEx) (LOGICAL_PROCESSOR_RELATIONSHIP, PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX, PDWORD) = NULL;
+    BOOL (WINAPI * ptrGetNumaProcessorNodeEx) (PPROCESSOR_NUMBER, PUSHORT) = NULL;
 
     template <typename T>
     bool IsMoreThanOneBitSet (T value) {
@@ -58,6 +59,7 @@ void InitPlatformAPI () {
         Symbol (hKernel32, ptrSetThreadGroupAffinity, "SetThreadGroupAffinity"); // NT 6.1+
         Symbol (hKernel32, ptrSetThreadIdealProcessorEx, "SetThreadIdealProcessorEx"); // NT 6.1+
         Symbol (hKernel32, ptrGetLogicalProcessorInformationEx, "GetLogicalProcessorInformationEx"); // NT 6.1+
+        Symbol (hKernel32, ptrGetNumaProcessorNodeEx, "GetNumaProcessorNodeEx"); // NT 6.1+
     }
 }
 
@@ -86,6 +88,20 @@ BOOL SetThreadIdealLogicalProcessor (HANDLE hThread, Processor processor) {
     }
 }
 
+USHORT GetLogicalProcessorNumaNode (Processor processor) {
+    if (ptrGetNumaProcessorNodeEx) {
+        USHORT node;
+        PROCESSOR_NUMBER number = { processor.group, processor.number };
+        if (ptrGetNumaProcessorNodeEx (&number, &node) && (node != 0xFFFF))
+            return node;
+    } else {
+        UCHAR node;
+        if (GetNumaProcessorNode (processor.number, &node) && (node != 0xFF))
+            return node;
+    }
+    return 0;
+}
+
 BOOL AssignThreadLogicalProcessor (HANDLE hThread, Processor processor) {
     bool affinity;
     if (ptrSetThreadGroupAffinity) {
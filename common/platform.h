@@ -110,6 +110,8 @@ bool IsHomogeneousSystem ();
 std::size_t GetPredominantSMT ();
 std::vector <Processor> GetRankedLogicalProcessorList ();
 
+USHORT GetLogicalProcessorNumaNode (Processor processor); // 0 if unknown
+
 BOOL AssignThreadLogicalProcessor (HANDLE hThread, Processor processor);
 BOOL SetThreadIdealLogicalProcessor (HANDLE hThread, Processor processor);
 
@@ -0,0 +1,72 @@
+#ifndef RADDI_THREADPOOL3_H
+#define RADDI_THREADPOOL3_H
+
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+// threadpool3_base
+//  - settings shared by all threadpool3 instantiations
+//
+class threadpool3_base {
+public:
+
+    // affinity
+    //  - pin workers to logical processors, set from proof::options::affinity
+    //  - Windows: through SetThreadGroupAffinity, cores first, filling one NUMA node before next
+    //  - Linux: worker N to processor N (modulo processor count), no NUMA placement
+    //
+    static inline bool affinity = false;
+};
+
+// threadpool3
+//  - portable (std::thread) threadpool with persistent workers and work stealing
+//  - workers live from 'init' to destruction, dispatching only queues work, no thread is created per round
+//  - work items are distributed round-robin into per-worker queues, worker takes from the front
+//    of its own queue and, when empty, steals from the back of others
+//
+template <typename Fiber>
+class threadpool3 : public threadpool3_base {
+    struct workitem {
+        Fiber *        fiber;
+        void (Fiber::* function) ();
+    };
+    struct alignas (64) queue {
+        std::mutex              lock;
+        std::deque <workitem>   items;
+    };
+
+    std::vector <std::thread>       workers;
+    std::unique_ptr <queue []>      queues;
+    std::size_t                     count = 0;      // number of queues
+
+    std::mutex                      lock;
+    std::condition_variable         wake;
+    std::condition_variable         done;
+    std::size_t                     generation = 0; // incremented whenever queued work is released
+    std::size_t                     remains = 0;    // dispatched and not yet finished
+    std::size_t                     deferred = 0;
+    std::size_t                     next = 0;
+    bool                            quit = false;
+
+private:
+    void thread (std::size_t index);
+    bool take (std::size_t index, workitem & item);
+
+public:
+    threadpool3 () = default;
+    ~threadpool3 ();
+
+    bool init (std::size_t workload);
+    void begin ();
+    bool dispatch (void (Fiber::*fn)(), Fiber *, bool defer);
+    void join ();
+    void stop ();
+};
+
+#include "threadpool3.tcc"
+#endif
@@ -0,0 +1,207 @@
+#ifndef RADDI_THREADPOOL3_TCC
+#define RADDI_THREADPOOL3_TCC
+
+#include "threadpool3.h"
+
+#ifdef _WIN32
+#include "platform.h"
+#include <algorithm>
+#include <utility>
+#endif
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+template <typename Fiber>
+threadpool3 <Fiber> ::~threadpool3 () {
+    this->stop ();
+}
+
+template <typename Fiber>
+bool threadpool3 <Fiber> ::init (std::size_t workload) {
+    if (!this->workers.empty ()) {
+        this->stop ();
+    }
+
+    auto processors = (std::size_t) std::thread::hardware_concurrency ();
+
+#ifdef _WIN32
+    // placement
+    //  - ranked processors (see GetRankedLogicalProcessorList) ordered by NUMA node they belong to,
+    //    so that pool no larger than a node stays on that node and shares its memory controller
+    //  - also spans processor groups, unlike 'hardware_concurrency'
+
+    std::vector <Processor> placement;
+    if (this->affinity) {
+        std::vector <std::pair <USHORT, Processor>> nodes;
+        for (const auto & processor : GetRankedLogicalProcessorList ()) {
+            nodes.emplace_back (GetLogicalProcessorNumaNode (processor), processor);
+        }
+        std::stable_sort (nodes.begin (), nodes.end (),
+                          [] (const auto & a, const auto & b) { return a.first < b.first; });
+
+        for (const auto & node : nodes) {
+            placement.push_back (node.second);
+        }
+        if (!placement.empty ()) {
+            processors = placement.size ();
+        }
+    }
+#endif
+    if (processors == 0) {
+        processors = 1;
+    }
+    if (workload > processors) {
+        workload = processors;
+    }
+    if (workload == 0) {
+        workload = 1;
+    }
+
+    try {
+        this->quit = false;
+        this->queues.reset (new queue [workload]);
+        this->count = workload;
+        this->workers.reserve (workload);
+
+        for (std::size_t i = 0; i != workload; ++i) {
+            this->workers.emplace_back (&threadpool3::thread, this, i);
+#ifdef _WIN32
+            if (!placement.empty ()) {
+                AssignThreadLogicalProcessor (this->workers.back ().native_handle (), placement [i % placement.size ()]);
+            }
+#endif
+#ifdef __linux__
+            if (this->affinity) {
+                cpu_set_t set;
+                CPU_ZERO (&set);
+                CPU_SET (i % processors, &set);
+                pthread_setaffinity_np (this->workers.back ().native_handle (), sizeof set, &set);
+            }
+#endif
+        }
+        return true;
+
+    } catch (...) {
+        this->stop ();
+        return false;
+    }
+}
+
+template <typename Fiber>
+void threadpool3 <Fiber> ::stop () {
+    {
+        std::unique_lock <std::mutex> guard (this->lock);
+        this->quit = true;
+    }
+    this->wake.notify_all ();
+
+    for (auto & worker : this->workers) {
+        worker.join ();
+    }
+    this->workers.clear ();
+}
+
+template <typename Fiber>
+void threadpool3 <Fiber> ::begin () {
+    std::unique_lock <std::mutex> guard (this->lock);
+    this->next = 0;
+}
+
+template <typename Fiber>
+bool threadpool3 <Fiber> ::dispatch (void (Fiber::*fn)(), Fiber * ctx, bool defer) {
+    if (this->workers.empty ())
+        return false;
+
+    std::unique_lock <std::mutex> guard (this->lock);
+    {
+        auto & q = this->queues [this->next++ % this->count];
+        std::unique_lock <std::mutex> qguard (q.lock);
+        q.items.push_back ({ ctx, fn });
+    }
+    ++this->remains;
+
+    if (defer) {
+        ++this->deferred;
+    } else {
+        this->deferred = 0;
+        ++this->generation;
+        guard.unlock ();
+        this->wake.notify_all ();
+    }
+    return true;
+}
+
+template <typename Fiber>
+void threadpool3 <Fiber> ::join () {
+    std::unique_lock <std::mutex> guard (this->lock);
+    if (this->deferred) {
+        this->deferred = 0;
+        ++this->generation;
+        this->wake.notify_all ();
+    }
+    this->done.wait (guard, [this] { return this->remains == 0; });
+}
+
+template <typename Fiber>
+bool threadpool3 <Fiber> ::take (std::size_t index, workitem & item) {
+    const auto n = this->count;
+
+    // own queue first, from the front
+
+    {
+        auto & q = this->queues [index];
+        std::unique_lock <std::mutex> guard (q.lock);
+        if (!q.items.empty ()) {
+            item = q.items.front ();
+            q.items.pop_front ();
+            return true;
+        }
+    }
+
+    // steal from the back of others, starting with neighbour
+
+    for (std::size_t i = 1; i != n; ++i) {
+        auto & q = this->queues [(index + i) % n];
+        std::unique_lock <std::mutex> guard (q.lock);
+        if (!q.items.empty ()) {
+            item = q.items.back ();
+            q.items.pop_back ();
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename Fiber>
+void threadpool3 <Fiber> ::thread (std::size_t index) {
+    std::size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock <std::mutex> guard (this->lock);
+            this->wake.wait (guard, [this, seen] { return this->quit || this->generation != seen; });
+
+            if (this->quit)
+                return;
+
+            seen = this->generation;
+        }
+
+        workitem work;
+        while (this->take (index, work)) {
+            try {
+                (work.fiber->*(work.function)) ();
+            } catch (...) {
+
+            }
+
+            std::unique_lock <std::mutex> guard (this->lock);
+            if (--this->remains == 0) {
+                this->done.notify_all ();
+            }
+        }
+    }
+}
+
+#endif
@@ -42,7 +42,7 @@ raddi::coordinator::coordinator (db & database)
     this->subscriptions.load ();
     this->blacklist.load ();
     this->retained.load ();
-    this->refused.load (this->database.path + L"\\refused\\");
+    this->refused.load (this->database.path + L"\\refused.eid", this->database.path + L"\\refused\\");
 };
 
 
@@ -103,7 +103,7 @@ void raddi::coordinator::flush () {
     this->subscriptions.flush ();
     this->blacklist.flush ();
     this->retained.flush ();
-    this->refused.save (this->database.path + L"\\refused\\");
+    this->refused.save (this->database.path + L"\\refused.eid");
 }
 
 void raddi::coordinator::optimize () {
@@ -674,22 +674,26 @@ bool raddi::coordinator::process_history (const raddi::request::subscription * s
     }
     if (oldest) {
         // first send all old thread-level entries (also meta, sideband updates, etc.)
-        auto n = this->database.threads->select (0, oldest, constrain, decission, transmitter);
+        auto n = this->database.threads->select ({ db::secondary::channel, db::secondary::thread }, channel,
+                                                 0, oldest, constrain, decission, transmitter);
         this->report (log::level::note, 0x2B, connection->peer, channel, oldest, n);
     }
     
     for (const auto & m : map) {
-        auto n = this->database.data->count (m.first.first, m.first.second);
+        auto n = this->database.data->count ({ db::secondary::channel, db::secondary::thread }, channel,
+                                             m.first.first, m.first.second);
         this->report (log::level::note, 0x27, connection->peer, channel, m.first.first, m.first.second, m.second, n);
 
         // if we have more entries than peer does
         if (n > m.second) {
-            this->database.data->select (m.first.first, m.first.second, constrain, decission, transmitter);
+            this->database.data->select ({ db::secondary::channel, db::secondary::thread }, channel,
+                                         m.first.first, m.first.second, constrain, decission, transmitter);
         }
     }
 
     // and finish with the most recent data
-    this->database.data->select (subscription->history.threshold, raddi::now (), constrain, decission, transmitter);
+    this->database.data->select ({ db::secondary::channel, db::secondary::thread }, channel,
+                                 subscription->history.threshold, raddi::now (), constrain, decission, transmitter);
     return true;
 }
 
@@ -746,7 +750,8 @@ void raddi::coordinator::process_download_request (const request::download * dow
                 || parent == row.top ().thread;
         };
         this->report (log::level::note, 0x28, connection->peer, threshold, now, parent);
-        this->database.data->select (threshold,  now, constrain, decission, transmitter);
+        this->database.data->select ({ db::secondary::channel, db::secondary::thread }, parent,
+                                     threshold, now, constrain, decission, transmitter);
     }
 }
 
@@ -1193,6 +1198,7 @@ std::size_t raddi::coordinator::gather_history (const eid & channel, raddi::requ
 
     try {
         total = this->database.data->select (
+            { db::secondary::channel, db::secondary::thread }, channel,
             s.now - this->database.settings.synchronization_threshold,
             s.now - this->database.settings.synchronization_base_offset,
 
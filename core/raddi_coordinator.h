@@ -89,8 +89,8 @@ namespace raddi {
 
         // retained
         //  - for entries/threads that are to be kept forever, not automatically deleted
-        //  - NOTE that application must add EIDs of the whole chain to keep
-        //  - TODO: timely data deletion is not implemented yet, so this is unused for now
+        //  - consulted by node when retiring data older than db 'retention_period'
+        //  - entry is kept if its EID, its thread or its channel is retained
         //
         raddi::subscription_set retained;
 
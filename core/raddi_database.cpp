@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cstring>
+#include <unordered_set>
 
 #include "raddi_database.h"
 #include "raddi_database_row.h"
@@ -48,10 +49,16 @@ raddi::db::db (file::access mode, const std::wstring & path)
                 this->identities->start ();
             }
 
-            this->data->reload ();
-            this->threads->reload ();
-            this->channels->reload ();
-            this->identities->reload ();
+            // tables enumerate their directories in parallel
+
+            this->warming.jobs = {
+                [this] { return this->data->reload (); },
+                [this] { return this->threads->reload (); },
+                [this] { return this->channels->reload (); },
+                [this] { return this->identities->reload (); },
+            };
+            this->warming.start (this->warming.jobs.size ());
+            this->warming.wait ();
 
             file f;
             if (f.open (path + L"\\xor", file::mode::always, mode, file::share::read, file::buffer::sequential)) {
@@ -77,6 +84,7 @@ raddi::db::db (file::access mode, const std::wstring & path)
                     }
                 }
                 f.close ();
+                this->prepare_mask ();
             }
 
         } else {
@@ -88,7 +96,224 @@ raddi::db::db (file::access mode, const std::wstring & path)
 }
 
 raddi::db::~db () {
-    // only here so the unique_ptr would work
+
+    // jobs reference tables, which are destroyed before the batches
+
+    this->warming.cancel ();
+    this->retirement.cancel ();
+    this->compaction.cancel ();
+}
+
+void raddi::db::warm_up () {
+    if (this->settings.warm_up_threads && this->idle ()) {
+        this->warming.jobs.clear ();
+        this->warming.finished = [this, started = GetTickCount64 ()] (const batch & b) {
+            this->report (log::level::event, 15, b.succeeded, GetTickCount64 () - started);
+        };
+
+        // announcement tables first, those are needed to assess every incoming entry
+
+        this->warm_up (this->identities.get (), (std::size_t) -1);
+        this->warm_up (this->channels.get (), (std::size_t) -1);
+        this->warm_up (this->threads.get (), this->settings.minimum_active_shards);
+        this->warm_up (this->data.get (), this->settings.minimum_active_shards);
+
+        this->warming.start (this->settings.warm_up_threads);
+    }
+}
+
+template <typename Key>
+void raddi::db::warm_up (table <Key> * t, std::size_t newest) {
+    for (auto base : t->unloaded (newest)) {
+        this->warming.jobs.push_back ([t, base] { return t->warm (base); });
+    }
+}
+
+bool raddi::db::retire (std::function <bool (const eid &, const root &)> keep) {
+    if (this->settings.retention_period && (this->mode == file::access::write) && this->idle ()) {
+        const auto threshold = raddi::now () - this->settings.retention_period;
+
+        this->retirement.jobs.clear ();
+
+        // threads with any entry newer than threshold are kept whole, including their old entries
+        //  - collected by the first job, single worker runs the jobs in order
+        //  - if the collection fails (not enough memory), nothing is removed in this pass
+
+        struct active {
+            std::unordered_set <eid, eid::hash> threads;
+            bool complete = false;
+        };
+        auto recent = std::make_shared <active> ();
+
+        this->retirement.jobs.push_back ([this, recent, threshold] {
+            this->data->select (threshold, raddi::now () + raddi::consensus::max_entry_skew_allowed,
+                                [recent] (const row & r, const auto &) { recent->threads.insert (r.top ().thread); return false; },
+                                [] (const row &, const auto &) { return false; },
+                                [] (const row &, const auto &, std::uint8_t *) {});
+            recent->complete = true;
+            return false;
+        });
+
+        const std::function <bool (const eid &, const root &)> retain = [recent, keep] (const eid & id, const root & top) {
+            return !recent->complete
+                || recent->threads.count (top.thread)
+                || keep (id, top);
+        };
+
+        this->retire (this->threads.get (), threshold, retain);
+        this->retire (this->data.get (), threshold, retain);
+
+        // single worker, retirement rewrites files and shouldn't compete with the node for disk
+
+        this->retirement.start (1);
+        return true;
+    } else
+        return false;
+}
+
+template <typename Key>
+void raddi::db::retire (table <Key> * t, std::uint32_t threshold, const std::function <bool (const eid &, const root &)> & keep) {
+    for (auto base : t->expired (threshold)) {
+        this->retirement.jobs.push_back ([t, base, threshold, keep] {
+            t->retire (base, threshold, keep);
+            return false;
+        });
+    }
+}
+
+void raddi::db::compact () {
+    if (this->settings.compaction_threshold && this->settings.shard_trimming_threshold
+            && (this->mode == file::access::write)
+            && !this->compaction.running () && !this->retirement.running ()) {
+
+        const auto now = raddi::now ();
+        if (this->compacted && !raddi::older (this->compacted + compaction_interval, now))
+            return;
+
+        this->compacted = now;
+        this->compaction.jobs.clear ();
+
+        const auto threshold = now - this->settings.shard_trimming_threshold;
+
+        this->compact (this->data.get (), threshold);
+        this->compact (this->threads.get (), threshold);
+        this->compact (this->channels.get (), threshold);
+        this->compact (this->identities.get (), threshold);
+
+        // single worker, same as retirement, compaction copies whole files
+
+        if (!this->compaction.jobs.empty ()) {
+            this->compaction.start (1);
+        }
+    }
+}
+
+template <typename Key>
+void raddi::db::compact (table <Key> * t, std::uint32_t threshold) {
+    for (auto base : t->inactive (threshold)) {
+        this->compaction.jobs.push_back ([this, t, base] {
+            return t->compact (base, this->settings.compaction_threshold);
+        });
+    }
+}
+
+bool raddi::db::expired (std::uint32_t timestamp) const {
+    return this->settings.retention_period
+        && raddi::older (timestamp, raddi::now () - this->settings.retention_period);
+}
+
+bool raddi::db::idle () const {
+    return !this->warming.running ()
+        && !this->retirement.running ();
+}
+
+std::size_t raddi::db::warming_up () const {
+    return this->warming.pending ();
+}
+
+raddi::db::batch::batch ()
+    : idle (CreateEvent (NULL, TRUE, TRUE, NULL)) {}
+
+raddi::db::batch::~batch () {
+    if (this->idle) {
+        this->cancel ();
+        CloseHandle (this->idle);
+    }
+}
+
+bool raddi::db::batch::running () const {
+    return this->idle
+        && (WaitForSingleObject (this->idle, 0) != WAIT_OBJECT_0);
+}
+
+void raddi::db::batch::wait () const {
+    if (this->idle) {
+        WaitForSingleObject (this->idle, INFINITE);
+    }
+}
+
+void raddi::db::batch::cancel () {
+    InterlockedExchange (&this->cancelled, 1);
+    this->wait ();
+}
+
+std::size_t raddi::db::batch::skip () {
+    if (this->running ()) {
+        const auto n = (LONG) this->jobs.size ();
+        const auto next = InterlockedExchange (&this->next, n);
+        if (next < n)
+            return std::size_t (n - next);
+    }
+    return 0;
+}
+
+std::size_t raddi::db::batch::pending () const {
+    if (this->running ()) {
+        const auto next = (std::size_t) this->next;
+        if (next < this->jobs.size ())
+            return this->jobs.size () - next;
+    }
+    return 0;
+}
+
+void raddi::db::batch::start (std::size_t concurrency) {
+    const auto n = std::min (concurrency, this->jobs.size ());
+    if (n && this->idle) {
+        this->next = 0;
+        this->succeeded = 0;
+        this->cancelled = 0;
+        this->workers = (LONG) n;
+        ResetEvent (this->idle);
+
+        for (std::size_t i = 0; i != n; ++i) {
+            if (!QueueUserWorkItem (procedure, this, WT_EXECUTELONGFUNCTION)) {
+                procedure (this);
+            }
+        }
+    }
+}
+
+DWORD WINAPI raddi::db::batch::procedure (LPVOID parameter) {
+    auto & b = *static_cast <batch *> (parameter);
+
+    LONG i;
+    while (!b.cancelled && ((std::size_t) (i = InterlockedIncrement (&b.next) - 1) < b.jobs.size ())) {
+        try {
+            if (b.jobs [i] ()) {
+                InterlockedIncrement (&b.succeeded);
+            }
+        } catch (const std::bad_alloc &) {
+            // shard will be loaded on first access
+        }
+    }
+
+    if (InterlockedDecrement (&b.workers) == 0) {
+        if (b.finished) {
+            b.finished (b);
+        }
+        SetEvent (b.idle);
+    }
+    return 0;
 }
 
 raddi::db::statistics raddi::db::stats () const {
@@ -228,6 +453,58 @@ bool raddi::db::insert (const entry * entry, std::size_t size, const root & top,
     return this->data->insert (entry, size, top, exists);
 }
 
+std::size_t raddi::db::insert (insertion * items, std::size_t n) {
+    std::vector <insertion *> identities;
+    std::vector <insertion *> channels;
+    std::vector <insertion *> threads;
+    std::vector <insertion *> data;
+
+    try {
+        for (std::size_t i = 0; i != n; ++i) {
+            const auto & item = items [i];
+
+            switch (item.entry->is_announcement ()) {
+                case raddi::entry::new_identity_announcement:
+                    identities.push_back (&items [i]);
+                    break;
+                case raddi::entry::new_channel_announcement:
+                    channels.push_back (&items [i]);
+                    break;
+
+                case raddi::entry::not_an_announcement:
+                    if ((item.entry->id == item.top.thread) && (item.entry->parent == item.top.channel)) {
+                        threads.push_back (&items [i]);
+                    }
+                    data.push_back (&items [i]);
+                    break;
+            }
+        }
+    } catch (const std::bad_alloc &) {
+        return 0;
+    }
+
+    std::size_t m = 0;
+    m += this->identities->insert (identities);
+    m += this->channels->insert (channels);
+
+    // threads are inserted to both tables, to 'data' only if successfully inserted to 'threads'
+    //  - 'exists' is then reported for the 'data' table
+
+    if (!threads.empty ()) {
+        this->threads->insert (threads);
+        data.erase (std::remove_if (data.begin (), data.end (),
+                                    [] (const insertion * item) {
+                                        return (item->entry->id == item->top.thread)
+                                            && (item->entry->parent == item->top.channel)
+                                            && !item->inserted && !item->exists;
+                                    }),
+                    data.end ());
+    }
+
+    m += this->data->insert (data);
+    return m;
+}
+
 bool raddi::db::erase (const eid & entry, bool thorough) {
     if (entry.identity.timestamp != entry.timestamp) {
         this->threads->erase (entry, thorough);
@@ -284,4 +561,87 @@ void raddi::db::optimize (bool strong) {
                       optimized, this->settings.shard_trimming_threshold,
                       pruned, limit);
     }
+
+    this->budget (strong);
+
+    // compaction is left out when optimizing for lack of memory (or disk space)
+
+    if (!strong) {
+        this->compact ();
+    }
+}
+
+std::size_t raddi::db::budget (bool strong) {
+    if (!this->settings.memory_budget)
+        return 0;
+
+    std::size_t limit = std::size_t (this->settings.memory_budget) * 1024 * 1024;
+    if (this->pressured) {
+        if (raddi::older (raddi::now (), this->pressured)) {
+            limit /= 2;
+        } else {
+            this->pressured = 0;
+        }
+    }
+
+    std::vector <usage> shards;
+    std::size_t total = 0;
+    try {
+        total += this->data->usage (shards, 0);
+        total += this->threads->usage (shards, 1);
+        total += this->channels->usage (shards, 2);
+        total += this->identities->usage (shards, 3);
+    } catch (const std::bad_alloc &) {
+        return 0;
+    }
+
+    if (total <= limit)
+        return 0;
+
+    // least recently used first
+    //  - evicting to 7/8 of the budget leaves headroom, so that every newly loaded shard
+    //    doesn't immediately force another one out
+
+    std::sort (shards.begin (), shards.end (),
+               [] (const usage & a, const usage & b) { return raddi::older (a.accessed, b.accessed); });
+
+    const auto target = limit - limit / 8;
+    const auto keep = strong ? 0u : this->settings.minimum_active_shards;
+    const auto used = total;
+
+    std::size_t closed = 0;
+    for (std::size_t i = 0; (i + keep < shards.size ()) && (total > target); ++i) {
+        const auto & shard = shards [i];
+
+        bool evicted = false;
+        switch (shard.table) {
+            case 0: evicted = this->data->evict (shard.base, shard.accessed); break;
+            case 1: evicted = this->threads->evict (shard.base, shard.accessed); break;
+            case 2: evicted = this->channels->evict (shard.base, shard.accessed); break;
+            case 3: evicted = this->identities->evict (shard.base, shard.accessed); break;
+        }
+        if (evicted) {
+            total -= shard.bytes;
+            ++closed;
+        }
+    }
+
+    if (closed) {
+        this->report (log::level::note, 17, closed, used / (1024 * 1024), limit / (1024 * 1024));
+    }
+    return closed;
+}
+
+void raddi::db::pressure () {
+
+    // pending warm-up loads are skipped, workers finish the shard they are loading
+    //  - retirement, verification and import run in their own batches and are left to complete
+
+    const auto cancelled = this->warming.skip ();
+
+    this->pressured = raddi::now () + pressure_period;
+    this->report (log::level::event, 20,
+                  this->settings.memory_budget / 2, pressure_period, cancelled);
+
+    this->optimize (true);
 }
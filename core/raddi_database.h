@@ -12,6 +12,7 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <functional>
 
 namespace raddi {
 
@@ -23,6 +24,113 @@ namespace raddi {
 
         file lock;
         std::vector <std::uint8_t> mask; // XOR mask for data
+        std::vector <std::uint8_t> mask_lanes; // 'mask' repeated for unaligned vector access
+
+        // mask_overhang
+        //  - number of bytes 'mask_lanes' extends past 'mask' size, at least the widest vector
+        //
+        static constexpr std::size_t mask_overhang = 64;
+
+        // prepare_mask
+        //  - builds 'mask_lanes' after 'mask' is loaded or generated
+        //
+        void prepare_mask ();
+
+        // batch
+        //  - set of background 'jobs' run in parallel on up to 'concurrency' thread pool workers, see 'start'
+        //  - 'jobs' are taken by workers in order, 'idle' is signalled when all workers exit
+        //  - every kind of background work has its own batch, jobs and state can be replaced only while idle
+        //     - 'succeeded' counts jobs that returned true, 'finished' is called by the last worker to exit
+        //
+        struct batch {
+            HANDLE          idle = NULL;
+            volatile LONG   workers = 0;
+            volatile LONG   next = 0;
+            volatile LONG   succeeded = 0;
+            volatile LONG   cancelled = 0;
+            std::vector <std::function <bool ()>> jobs;
+            std::function <void (const batch &)> finished;
+
+            batch ();
+            ~batch ();
+
+            // start
+            //  - resets the state, including 'cancelled', and starts workers
+            //
+            void start (std::size_t concurrency);
+
+            // running/wait
+            //  - running returns true until all workers exit, wait blocks until then
+            //
+            bool running () const;
+            void wait () const;
+
+            // cancel
+            //  - stops the workers after their current job and waits for them to exit
+            //
+            void cancel ();
+
+            // skip
+            //  - pending jobs won't be started, current ones complete
+            //  - returns number of jobs skipped
+            //
+            std::size_t skip ();
+
+            // pending
+            //  - returns number of jobs not yet started
+            //
+            std::size_t pending () const;
+
+        private:
+            static DWORD WINAPI procedure (LPVOID);
+
+            batch (const batch &) = delete;
+            batch & operator = (const batch &) = delete;
+        };
+
+        // warming/retirement/compaction
+        //  - background work started by constructor (tables reload) and 'warm_up', by 'retire',
+        //    and by 'optimize' (see 'compact')
+        //  - 'verify' and 'import' use batches of their own, local to the call
+        //
+        batch warming;
+        batch retirement;
+        batch compaction;
+
+        // compacted
+        //  - timestamp of last compaction pass, passes are at least 'compaction_interval' apart
+        //
+        std::uint32_t compacted = 0;
+        static constexpr std::uint32_t compaction_interval = 3600; // 1 hour
+
+        // idle
+        //  - no background work ('warming' or 'retirement') is running
+        //
+        bool idle () const;
+
+        // pressured
+        //  - timestamp until which the memory budget is halved, set by 'pressure'
+        //
+        std::uint32_t pressured = 0;
+        static constexpr std::uint32_t pressure_period = 600; // 10 minutes
+
+        // usage
+        //  - memory used by single loaded shard, see 'table::usage'
+        //
+        struct usage {
+            std::uint32_t accessed;
+            std::uint32_t base;
+            std::size_t   bytes;
+            unsigned int  table; // 0 - data, 1 - threads, 2 - channels, 3 - identities
+        };
+
+        // budget
+        //  - closes least recently used shards, across all tables, until their caches fit
+        //    into 7/8 of the (possibly halved) 'memory_budget'
+        //  - keeps at least 'minimum_active_shards' loaded unless 'strong'
+        //  - returns number of shards closed
+        //
+        std::size_t budget (bool strong);
 
     public:
         // root
@@ -82,6 +190,26 @@ namespace raddi {
             //
             unsigned int maximum_shard_size = 8192;
 
+            // insert_batch_size (entries)
+            //  - max number of entries written to a single shard with one write to index and content
+            //    file while holding the table lock, when inserting through batched 'insert'
+            //
+            unsigned int insert_batch_size = 128;
+
+            // bloom_filter_bits
+            //  - bits per row of per-shard Bloom filters, consulted before loading shard on lookups
+            //  - filters are stored in '.b' files next to shard index; 0 disables the filters
+            //
+            unsigned int bloom_filter_bits = 10;
+
+            // compaction_threshold (percent)
+            //  - shards inactive for 'shard_trimming_threshold', loaded or not, get their content file
+            //    compacted in background, if at least this percentage of it is not referenced
+            //    (erased entries, data of split shard)
+            //  - 0 disables compaction
+            //
+            unsigned int compaction_threshold = 30;
+
             // shard_trimming_threshold
             //  - how long will a shard stay in memory after last access
             //  - default is 20 minutes now, using 0 will disable trimming
@@ -100,8 +228,48 @@ namespace raddi {
             //
             unsigned int maximum_active_shards = 768;
 
+            // memory_budget (MiB)
+            //  - limit for memory used by loaded shards: caches of rows, secondary indexes,
+            //    Bloom filters and mapped views of content files
+            //  - least recently used shards are closed, by 'optimize', when exceeded
+            //  - halved for 10 minutes after low memory notification, see 'pressure'
+            //  - 0 disables the limit
+            //
+            unsigned int memory_budget = 512;
+
+            // warm_up_threads
+            //  - number of thread pool workers loading shards in parallel on 'warm_up'
+            //  - 0 disables warm-up, shards are then loaded on first access
+            //
+            unsigned int warm_up_threads = 4;
+
+            // retention_period (seconds)
+            //  - 'retire' removes entries older than this from data and threads tables,
+            //    except those the caller chooses to keep
+            //  - 0 keeps everything forever
+            //
+            unsigned int retention_period = 0;
+
+            // memory_mapped_shards
+            //  - shard content files (and index files while loading) are read through mapped views
+            //    instead of file reads, data appended later are read directly until remapped
+            //  - disabled by default on 32-bit builds to conserve address space
+            //
+#ifdef _WIN64
+            bool memory_mapped_shards = true;
+#else
+            bool memory_mapped_shards = false;
+#endif
+
+            // write_ahead_journal
+            //  - appends to shard files are first written through to per-table journal,
+            //    replayed on start, so that periodic 'flush' is enough to keep files consistent
+            //  - existing journal is always replayed, disabling only stops writing new records
+            //
+            bool write_ahead_journal = true;
+
             // disk_flush_interval
-            //  - 
+            //  - flush of shard files, data are safe in journal until then, see above
             //
             unsigned int disk_flush_interval = 4000; // 4s
 
@@ -119,6 +287,7 @@ namespace raddi {
         //
         struct statistics {
             std::size_t rows = 0;
+            std::size_t bytes = 0; // memory used by loaded shards, see 'memory_budget'
             struct {
                 std::size_t total = 0;
                 std::size_t active = 0;
@@ -126,6 +295,7 @@ namespace raddi {
 
             void operator += (const statistics & other) {
                 this->rows += other.rows;
+                this->bytes += other.bytes;
                 this->shards.total += other.shards.total;
                 this->shards.active += other.shards.active;
             }
@@ -158,14 +328,51 @@ namespace raddi {
         //
         void flush ();
 
+        // warm_up
+        //  - loads shards that are likely to be needed soon, in parallel, in background:
+        //    all shards of channels and identities, newest 'minimum_active_shards' of the rest
+        //  - returns immediately, database is fully usable while warm-up continues
+        //  - pending loads are cancelled by destructor
+        //
+        void warm_up ();
+
+        // warming_up
+        //  - returns number of shards still waiting to be loaded by 'warm_up'
+        //
+        std::size_t warming_up () const;
+
+        // retire
+        //  - starts background removal of entries older than 'retention_period' from data and threads
+        //  - 'keep' selects old entries to retain, shards left only with those are compacted,
+        //    shards where nothing is retained are deleted
+        //  - threads with any entry newer than the threshold are kept whole
+        //  - returns false if disabled, not a writer, or if warm-up or previous pass is still running
+        //
+        bool retire (std::function <bool (const eid & entry, const root & top)> keep);
+
+        // expired
+        //  - returns true if entry of 'timestamp' is older than 'retention_period' (if enabled),
+        //    i.e. it would be removed by next 'retire', unless kept
+        //
+        bool expired (std::uint32_t timestamp) const;
+
         // optimize
         //  - closes database shards that weren't in use for some time
         //    and all that exceed maximum
         //  - strong optimization will keep only minimum shards open
         //    (used when low on memory)
+        //  - then closes least recently used shards over 'memory_budget'
+        //  - regular (not strong) optimization also starts background compaction, see 'compact'
         //
         void optimize (bool strong = false);
 
+        // pressure
+        //  - response to low memory notification, degrades gracefully instead of paging:
+        //    cancels pending warm-up, halves 'memory_budget' for a while and optimizes strongly
+        //  - warm-up and shard loads on access continue as usual, only within the reduced budget
+        //
+        void pressure ();
+
         // assess/assessment/assessed_table
         //  - verifies proof and signature entry against identity in database
         //  - root is not provided for 'rejected' and 'detached' results
@@ -195,6 +402,27 @@ namespace raddi {
         //
         bool insert (const entry * entry, std::size_t size, const root &, bool & exists);
 
+        // insertion
+        //  - single item of batched 'insert' below
+        //  - 'exists' and 'inserted' are results, same meaning as for single 'insert'
+        //
+        struct insertion {
+            const raddi::entry * entry = nullptr;
+            std::size_t          size = 0;
+            root                 top;
+
+            bool exists = false;
+            bool inserted = false;
+        };
+
+        // insert (batch)
+        //  - inserts multiple entries, rows destined for the same shard are grouped and written
+        //    with single write to each the index and content file
+        //  - table lock is released between the groups
+        //  - returns number of items that were successfully inserted or already existed
+        //
+        std::size_t insert (insertion * items, std::size_t n);
+
         // erase
         //  - erases specified entry from the database
         //  - if 'thorough' then also content is overwritten by zeros
@@ -208,6 +436,44 @@ namespace raddi {
         //
         bool get (const eid &, void * buffer, std::size_t * length) const;
 
+        // export_snapshot
+        //  - writes entries within 'oldest'..'latest' into portable snapshot file at 'path'
+        //  - snapshot is sorted, chunked by table and time range, checksummed and independent of 'mask'
+        //  - implemented in 'raddi_database_snapshot.cpp'
+        //  - returns number of entries written, or -1 on failure
+        //
+        std::size_t export_snapshot (const std::wstring & path, std::uint32_t oldest, std::uint32_t latest) const;
+
+        // import_snapshot
+        //  - bulk-loads snapshot at 'path' through batched 'insert', bypassing 'assess'
+        //  - signatures of each chunk are verified in parallel before it is inserted,
+        //    corrupted chunk stops the import
+        //  - root of every entry is derived from its parent, entries whose stored root doesn't match,
+        //    or whose parent is neither in the database nor earlier in the snapshot, are rejected
+        //  - returns number of entries inserted
+        //
+        std::size_t import_snapshot (const std::wstring & path);
+
+        // verification
+        //  - result of 'verify'
+        //
+        struct verification {
+            std::size_t shards = 0;
+            std::size_t rows = 0;
+            std::size_t invalid = 0;
+            std::size_t repaired = 0;
+        };
+
+        // verify
+        //  - verifies all shards of all tables in parallel on 'threads' workers (0 - all processors)
+        //  - checks that index rows point into content file, entries validate, signatures and
+        //    proofs-of-work verify, parents exist and threads are present in data table
+        //  - if 'repair' then invalid rows are erased and shard caches and indexes rebuilt,
+        //    writer only, each table is paused (locked) while its shard is being repaired
+        //  - implemented in 'raddi_database_verification.cpp'
+        //
+        verification verify (bool repair = false, unsigned int threads = 0);
+
         // typical use scenarios
         //  - search identities
         //  - search channels
@@ -216,6 +482,13 @@ namespace raddi {
         //  - list whole tree belonging to a thread
         //  - list all posts/etc by some identity
 
+        // xor_mask
+        //  - masks/unmasks 'length' bytes of content found at 'position' in shard content file
+        //  - 'target' and 'source' may be the same buffer
+        //  - vectorized where possible, implemented in 'raddi_database_mask.cpp'
+        //
+        void xor_mask (void * target, const void * source, std::size_t length, std::uintmax_t position) const;
+
         // shard_instance_name
         //  - implemented in 'raddi_database_shard.cpp'
         //
@@ -240,11 +513,27 @@ namespace raddi {
         template <typename Key>
         class table;
 
+        template <typename Key>
+        void warm_up (table <Key> *, std::size_t newest);
+
+        template <typename Key>
+        void retire (table <Key> *, std::uint32_t threshold, const std::function <bool (const eid &, const root &)> & keep);
+
+        // compact
+        //  - queues compaction of inactive shards of all tables (writer), see table::compact
+        //  - not while previous pass or retirement runs, and at most once per 'compaction_interval'
+        //
+        void compact ();
+
+        template <typename Key>
+        void compact (table <Key> *, std::uint32_t threshold);
+
     public:
 
         // following internal classes are defined in their own headers
 
         enum class read : unsigned int; // raddi_database_row.h
+        enum class secondary : unsigned int; // raddi_database_row.h
 
         // rows
         //  - raddi_database_row.h
@@ -255,11 +544,36 @@ namespace raddi {
         struct crow; // channels index row
         struct irow; // identities index row
 
+        // summary_query
+        //  - raddi_database_row.h
+        //  - mask/value predicate over content summary of data rows
+
+        struct summary_query;
+
         // peers
         //  - raddi_database_peerset.h
 
         class peerset;
 
+        // rowset
+        //  - raddi_database_rowset.h
+        //  - sorted container for shard cache and secondary indexes
+
+        template <typename T>
+        class rowset;
+
+        // bloom
+        //  - raddi_database_bloom.h
+        //  - per-shard filter of row ids
+
+        class bloom;
+
+        // journal
+        //  - raddi_database_journal.h
+        //  - per-table write-ahead log of shard appends
+
+        class journal;
+
         // tables
         //  - data - data that are not announcements (channels or identities)
         //  - threads - root thread entries (copy for fast lookup)
@@ -0,0 +1,125 @@
+#include "raddi_database_bloom.h"
+#include <algorithm>
+
+namespace {
+
+    // header
+    //  - of '.b' file, followed by the filter bits
+    //
+    struct header {
+        std::uint64_t covers;
+        std::uint32_t capacity;
+        std::uint32_t count;
+        std::uint32_t hashes;
+        std::uint32_t words;
+    };
+
+    // hash
+    //  - two independent 64-bit hashes of the id bytes, combined as h1 + i * h2
+    //
+    inline std::uint64_t mix (std::uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9uLL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebuLL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    inline void hash (const void * id, std::size_t size, std::uint64_t & h1, std::uint64_t & h2) {
+        std::uint64_t h = 0xcbf29ce484222325uLL;
+        for (std::size_t i = 0; i != size; ++i) {
+            h ^= static_cast <const std::uint8_t *> (id) [i];
+            h *= 0x100000001b3uLL;
+        }
+        h1 = mix (h);
+        h2 = mix (h ^ 0x9e3779b97f4a7c15uLL) | 1;
+    }
+}
+
+void raddi::db::bloom::reset (std::size_t capacity, unsigned int bits_per_row) {
+    const auto n = std::max <std::size_t> (64, capacity * bits_per_row);
+
+    this->bits.assign ((n + 63) / 64, 0);
+    this->capacity = (std::uint32_t) capacity;
+    this->count = 0;
+    this->covers = 0;
+    this->dirty = true;
+
+    // optimal number of hash functions is bits_per_row * ln 2
+
+    this->hashes = std::max (1u, (bits_per_row * 69u + 50u) / 100u);
+}
+
+void raddi::db::bloom::clear () {
+    this->bits.clear ();
+    this->bits.shrink_to_fit ();
+    this->capacity = 0;
+    this->count = 0;
+    this->covers = 0;
+    this->dirty = false;
+}
+
+void raddi::db::bloom::insert (const void * id, std::size_t size) {
+    if (!this->bits.empty ()) {
+        std::uint64_t h1, h2;
+        hash (id, size, h1, h2);
+
+        const auto n = this->bits.size () * 64;
+        for (auto i = 0u; i != this->hashes; ++i) {
+            const auto bit = (h1 + i * h2) % n;
+            this->bits [bit / 64] |= 1uLL << (bit % 64);
+        }
+        ++this->count;
+        this->dirty = true;
+    }
+}
+
+bool raddi::db::bloom::contains (const void * id, std::size_t size) const {
+    if (!this->bits.empty ()) {
+        std::uint64_t h1, h2;
+        hash (id, size, h1, h2);
+
+        const auto n = this->bits.size () * 64;
+        for (auto i = 0u; i != this->hashes; ++i) {
+            const auto bit = (h1 + i * h2) % n;
+            if (!(this->bits [bit / 64] & (1uLL << (bit % 64))))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool raddi::db::bloom::save (file & f) const {
+    header h;
+    h.covers = this->covers;
+    h.capacity = this->capacity;
+    h.count = this->count;
+    h.hashes = this->hashes;
+    h.words = (std::uint32_t) this->bits.size ();
+
+    return f.write (h)
+        && f.write (this->bits.data (), this->bits.size () * sizeof (std::uint64_t));
+}
+
+bool raddi::db::bloom::load (file & f) {
+    header h;
+    if (f.read (h) && h.hashes && h.words && (h.hashes <= 64)
+            && (f.size () == sizeof h + h.words * sizeof (std::uint64_t))) {
+        try {
+            this->bits.resize (h.words);
+            if (f.read (this->bits.data (), this->bits.size () * sizeof (std::uint64_t))) {
+                this->covers = h.covers;
+                this->capacity = h.capacity;
+                this->count = h.count;
+                this->hashes = h.hashes;
+                this->dirty = false;
+                return true;
+            }
+        } catch (const std::bad_alloc &) {
+            // fail
+        }
+    }
+    this->clear ();
+    return false;
+}
@@ -0,0 +1,77 @@
+#ifndef RADDI_DATABASE_BLOOM_H
+#define RADDI_DATABASE_BLOOM_H
+
+#include "raddi_database.h"
+#include "../common/file.h"
+
+#include <cstdint>
+#include <vector>
+
+// bloom
+//  - per-shard Bloom filter over row ids, answers "certainly not present" without loading the shard
+//  - persisted in shard's '.b' file, valid only for index file of size it was built for ('covers')
+//  - erased rows are not removed, that only increases false positive rate a little
+//
+class raddi::db::bloom {
+    std::vector <std::uint64_t> bits;
+    std::uint32_t hashes = 0;
+    std::uint32_t capacity = 0; // number of rows the filter was sized for
+    std::uint32_t count = 0;
+
+public:
+
+    // covers
+    //  - size of shard index file (in bytes) that the filter reflects
+    //
+    std::uint64_t covers = 0;
+
+    // dirty
+    //  - changed since last 'save'
+    //
+    bool dirty = false;
+
+    // reset
+    //  - clears the filter and sizes it for 'capacity' rows with 'bits_per_row' bits each
+    //
+    void reset (std::size_t capacity, unsigned int bits_per_row);
+
+    // clear
+    //  - releases the filter, 'empty' returns true until 'reset' or 'load'
+    //
+    void clear ();
+    bool empty () const { return this->bits.empty (); }
+
+    // footprint
+    //  - bytes allocated by the filter
+    //
+    std::size_t footprint () const { return this->bits.capacity () * sizeof (std::uint64_t); }
+
+    // full
+    //  - more rows were inserted than the filter was sized for, rebuild to keep false positives low
+    //
+    bool full () const { return this->count > this->capacity; }
+
+    // insert/contains
+    //  - id is hashed as raw bytes
+    //
+    void insert (const void * id, std::size_t size);
+    bool contains (const void * id, std::size_t size) const;
+
+    template <typename T>
+    void insert (const T & id) {
+        this->insert (&id, sizeof id);
+    }
+    template <typename T>
+    bool contains (const T & id) const {
+        return this->contains (&id, sizeof id);
+    }
+
+    // save/load
+    //  - writes/reads the filter into/from opened file
+    //  - load fails if the file is malformed
+    //
+    bool save (file &) const;
+    bool load (file &);
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "raddi_database_journal.h"
+#include <cstring>
+#include <lzma.h>
+
+namespace {
+
+    // header
+    //  - of journal record, 'crc' covers the record (with 'crc' zero) and data that follow
+    //
+    struct header {
+        raddi::db::journal::record record;
+        std::uint64_t              crc;
+    };
+
+    std::uint64_t checksum (const header & h, const void * rows, const void * content) {
+        header zeroed = h;
+        zeroed.crc = 0;
+
+        auto crc = lzma_crc64 (reinterpret_cast <const std::uint8_t *> (&zeroed), sizeof zeroed, 0);
+        crc = lzma_crc64 (static_cast <const std::uint8_t *> (rows), h.record.index_length, crc);
+        crc = lzma_crc64 (static_cast <const std::uint8_t *> (content), h.record.content_length, crc);
+        return crc;
+    }
+}
+
+bool raddi::db::journal::append (const record & r, const void * rows, const void * content) {
+    exclusive guard (this->lock);
+
+    if (this->f.closed ()) {
+        if (!this->f.open (this->path, file::mode::always, file::access::write, file::share::read, file::buffer::write_through))
+            return false;
+
+        this->f.tail ();
+    }
+
+    header h;
+    h.record = r;
+    h.crc = checksum (h, rows, content);
+
+    // single write, so that the record is either complete or detectably torn
+
+    try {
+        this->buffer.resize (sizeof h + r.index_length + r.content_length);
+    } catch (const std::bad_alloc &) {
+        return false;
+    }
+
+    std::memcpy (&this->buffer [0], &h, sizeof h);
+    std::memcpy (&this->buffer [sizeof h], rows, r.index_length);
+    std::memcpy (&this->buffer [sizeof h + r.index_length], content, r.content_length);
+
+    const auto position = this->f.tell ();
+    if (this->f.write (this->buffer.data (), this->buffer.size ()))
+        return true;
+
+    // partial write would make following records unreachable by replay
+
+    this->f.resize (position);
+    this->f.seek (position);
+    return false;
+}
+
+bool raddi::db::journal::empty () const {
+    immutability guard (this->lock);
+    return this->f.closed () || (this->f.tell () == 0);
+}
+
+bool raddi::db::journal::checkpoint () {
+    exclusive guard (this->lock);
+
+    if (this->buffer.capacity () > 1024 * 1024) {
+        this->buffer.clear ();
+        this->buffer.shrink_to_fit ();
+    }
+    if (this->f.closed () || (this->f.tell () == 0))
+        return true;
+
+    if (this->f.resize (0)) {
+        this->f.seek (0);
+        return true;
+    } else
+        return false;
+}
+
+bool raddi::db::journal::discard () {
+    exclusive guard (this->lock);
+
+    this->f.close ();
+    return DeleteFile (this->path.c_str ())
+        || (GetLastError () == ERROR_FILE_NOT_FOUND);
+}
+
+std::size_t raddi::db::journal::replay (const std::function <bool (const record &, const std::uint8_t *, const std::uint8_t *)> & callback,
+                                        std::uintmax_t * torn) {
+    exclusive guard (this->lock);
+
+    file f;
+    if (!f.open (this->path, file::mode::open, file::access::read, file::share::read, file::buffer::sequential))
+        return (std::size_t) -1;
+
+    const auto size = f.size ();
+    std::uintmax_t offset = 0;
+    std::size_t n = 0;
+
+    std::vector <std::uint8_t> data;
+    header h;
+
+    while (f.read (h)) {
+        const auto length = std::uintmax_t (h.record.index_length) + h.record.content_length;
+        if (length > size - offset - sizeof h)
+            break;
+
+        try {
+            data.resize ((std::size_t) length);
+        } catch (const std::bad_alloc &) {
+            break;
+        }
+
+        if (!f.read (data.data (), data.size ())
+                || (checksum (h, data.data (), data.data () + h.record.index_length) != h.crc))
+            break;
+
+        if (!callback (h.record, data.data (), data.data () + h.record.index_length))
+            break;
+
+        offset += sizeof h + length;
+        ++n;
+    }
+
+    if (torn) {
+        *torn = offset;
+    }
+    return n;
+}
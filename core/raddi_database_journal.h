@@ -0,0 +1,82 @@
+#ifndef RADDI_DATABASE_JOURNAL_H
+#define RADDI_DATABASE_JOURNAL_H
+
+#include "raddi_database.h"
+#include "../common/file.h"
+#include "../common/lock.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// journal
+//  - per-table write-ahead log of appends to shard files, written through to disk before the shard
+//    files are written, so that those can be flushed only occasionally (see 'disk_flush_interval')
+//  - record is header with shard base, positions and lengths in index and content file, and CRC-64,
+//    followed by the index rows and masked content exactly as appended to the shard files
+//  - replayed when table is loaded, rewriting appended ranges that might not have reached the disk;
+//    torn record at the end is ignored, its data were never written to shard files
+//  - emptied by 'checkpoint' after shard files are flushed, table does that also before any change
+//    other than append (erase, split, compaction, retirement, repair) as replay would revert those
+//
+class raddi::db::journal {
+    mutable ::lock             lock;
+    file                       f;
+    std::vector <std::uint8_t> buffer;
+
+public:
+    const std::wstring path;
+
+    // record
+    //  - describes single append to files of shard 'base'
+    //
+    struct record {
+        std::uint32_t  base;
+        std::uint32_t  index_length;
+        std::uint32_t  content_length;
+        std::uint32_t  reserved;
+        std::uint64_t  index_position;
+        std::uint64_t  content_position;
+    };
+
+public:
+    explicit journal (const std::wstring & path)
+        : path (path) {}
+
+    // append
+    //  - writes the record and its data, opens (creates) the journal file on first use
+    //  - returns after the data are on disk, false on failure
+    //
+    bool append (const record &, const void * rows, const void * content);
+
+    // empty
+    //  - nothing was appended since last 'checkpoint'
+    //
+    bool empty () const;
+
+    // checkpoint
+    //  - empties the journal, caller guarantees all shard files were flushed
+    //
+    bool checkpoint ();
+
+    // discard
+    //  - closes and deletes the journal file, after it was successfully replayed
+    //
+    bool discard ();
+
+    // replay
+    //  - calls 'callback' for every complete record in the journal file, in order
+    //     - callback signature: bool f (const record &, const std::uint8_t * rows, const std::uint8_t * content);
+    //     - returning false stops the replay, the journal is then kept
+    //  - 'torn' receives offset of the first incomplete or corrupted record, or file size
+    //  - returns number of records replayed, or -1 if there is no journal
+    //
+    std::size_t replay (const std::function <bool (const record &, const std::uint8_t *, const std::uint8_t *)> & callback,
+                        std::uintmax_t * torn);
+
+private:
+    journal (const journal &) = delete;
+    journal & operator = (const journal &) = delete;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "raddi_database.h"
+
+#include <cstring>
+#include <sodium.h>
+
+#if defined (_M_X64) || defined (_M_AMD64) || defined (__x86_64__) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2) || defined (__SSE2__)
+#define RADDI_MASK_SSE2
+#include <immintrin.h>
+#endif
+#if defined (_M_ARM64) || defined (__ARM_NEON)
+#define RADDI_MASK_NEON
+#include <arm_neon.h>
+#endif
+
+// xor_mask
+//  - implementations, all compute target [i] = source [i] ^ mask [(position + i) % size]
+//  - 'lanes' is the mask repeated to (size + overhang) bytes, so that any vector load
+//    starting at offset < size can be done without wrapping
+//  - 'k' is (position % size) on entry, the functions return updated offset
+//
+namespace {
+    using xor_mask_function = std::size_t (*) (std::uint8_t *, const std::uint8_t *, std::size_t,
+                                               const std::uint8_t *, std::size_t, std::size_t);
+
+    inline std::size_t wrap (std::size_t k, std::size_t size) {
+        while (k >= size) {
+            k -= size;
+        }
+        return k;
+    }
+
+    std::size_t xor_mask_scalar (std::uint8_t * target, const std::uint8_t * source, std::size_t length,
+                                 const std::uint8_t * lanes, std::size_t size, std::size_t k) {
+        while (length >= sizeof (std::uint64_t)) {
+            std::uint64_t data;
+            std::uint64_t mask;
+            std::memcpy (&data, source, sizeof data);
+            std::memcpy (&mask, lanes + k, sizeof mask);
+
+            data ^= mask;
+            std::memcpy (target, &data, sizeof data);
+
+            source += sizeof data;
+            target += sizeof data;
+            length -= sizeof data;
+            k = wrap (k + sizeof data, size);
+        }
+        while (length--) {
+            *target++ = *source++ ^ lanes [k];
+            k = wrap (k + 1, size);
+        }
+        return k;
+    }
+
+#ifdef RADDI_MASK_SSE2
+    std::size_t xor_mask_sse2 (std::uint8_t * target, const std::uint8_t * source, std::size_t length,
+                               const std::uint8_t * lanes, std::size_t size, std::size_t k) {
+        while (length >= sizeof (__m128i)) {
+            auto data = _mm_loadu_si128 (reinterpret_cast <const __m128i *> (source));
+            auto mask = _mm_loadu_si128 (reinterpret_cast <const __m128i *> (lanes + k));
+            _mm_storeu_si128 (reinterpret_cast <__m128i *> (target), _mm_xor_si128 (data, mask));
+
+            source += sizeof (__m128i);
+            target += sizeof (__m128i);
+            length -= sizeof (__m128i);
+            k = wrap (k + sizeof (__m128i), size);
+        }
+        return xor_mask_scalar (target, source, length, lanes, size, k);
+    }
+
+#ifdef __GNUC__
+    __attribute__ ((target ("avx2")))
+#endif
+    std::size_t xor_mask_avx2 (std::uint8_t * target, const std::uint8_t * source, std::size_t length,
+                               const std::uint8_t * lanes, std::size_t size, std::size_t k) {
+        while (length >= sizeof (__m256i)) {
+            auto data = _mm256_loadu_si256 (reinterpret_cast <const __m256i *> (source));
+            auto mask = _mm256_loadu_si256 (reinterpret_cast <const __m256i *> (lanes + k));
+            _mm256_storeu_si256 (reinterpret_cast <__m256i *> (target), _mm256_xor_si256 (data, mask));
+
+            source += sizeof (__m256i);
+            target += sizeof (__m256i);
+            length -= sizeof (__m256i);
+            k = wrap (k + sizeof (__m256i), size);
+        }
+        return xor_mask_sse2 (target, source, length, lanes, size, k);
+    }
+#endif
+
+#ifdef RADDI_MASK_NEON
+    std::size_t xor_mask_neon (std::uint8_t * target, const std::uint8_t * source, std::size_t length,
+                               const std::uint8_t * lanes, std::size_t size, std::size_t k) {
+        while (length >= sizeof (uint8x16_t)) {
+            vst1q_u8 (target, veorq_u8 (vld1q_u8 (source), vld1q_u8 (lanes + k)));
+
+            source += sizeof (uint8x16_t);
+            target += sizeof (uint8x16_t);
+            length -= sizeof (uint8x16_t);
+            k = wrap (k + sizeof (uint8x16_t), size);
+        }
+        return xor_mask_scalar (target, source, length, lanes, size, k);
+    }
+#endif
+
+    xor_mask_function select_xor_mask_function () {
+#if defined (RADDI_MASK_SSE2)
+        if (sodium_runtime_has_avx2 ())
+            return xor_mask_avx2;
+        else
+            return xor_mask_sse2;
+#elif defined (RADDI_MASK_NEON)
+        return xor_mask_neon;
+#else
+        return xor_mask_scalar;
+#endif
+    }
+}
+
+void raddi::db::prepare_mask () {
+    this->mask_lanes.clear ();
+
+    if (const auto size = this->mask.size ()) {
+        this->mask_lanes.resize (size + mask_overhang);
+        for (std::size_t i = 0; i != this->mask_lanes.size (); ++i) {
+            this->mask_lanes [i] = this->mask [i % size];
+        }
+    }
+}
+
+void raddi::db::xor_mask (void * target, const void * source, std::size_t length, std::uintmax_t position) const {
+    if (const auto size = this->mask.size ()) {
+        static const auto implementation = select_xor_mask_function ();
+
+        implementation (static_cast <std::uint8_t *> (target), static_cast <const std::uint8_t *> (source), length,
+                        this->mask_lanes.data (), size, (std::size_t) (position % size));
+    } else {
+        if (target != source) {
+            std::memmove (target, source, length);
+        }
+    }
+}
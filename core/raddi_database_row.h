@@ -56,6 +56,21 @@ public:
         return this->top_;
     }
 
+    // indexed
+    //  - shards of this table maintain secondary indexes (see 'secondary')
+    //
+    static constexpr bool indexed = true;
+
+    // summarized
+    //  - rows carry content 'type' and shards aggregate it, see 'summary_query'
+    //
+    static constexpr bool summarized = true;
+
+    // secondary
+    //  - returns key of this row in provided secondary index
+    //
+    inline eid secondary (db::secondary index) const;
+
     // classify
     //  - parses entry and initializes members other than 'data'
     //
@@ -105,6 +120,21 @@ public:
         return { this->parent, this->id };
     }
 
+    // indexed
+    //  - shards of this table maintain secondary indexes (see 'secondary')
+    //
+    static constexpr bool indexed = true;
+
+    // summarized
+    //  - no content 'type' is stored for these rows
+    //
+    static constexpr bool summarized = false;
+
+    // secondary
+    //  - returns key of this row in provided secondary index
+    //
+    inline eid secondary (db::secondary index) const;
+
     // classify
     //  - parses entry and initializes members other than 'data'
     //
@@ -161,6 +191,21 @@ public:
         return { this->id, this->id };
     }
 
+    // indexed
+    //  - channel announcements are their own channel, nothing to index
+    //
+    static constexpr bool indexed = false;
+
+    // summarized
+    //  - no content 'type' is stored for these rows
+    //
+    static constexpr bool summarized = false;
+
+    // secondary
+    //  - returns key of this row in provided secondary index
+    //
+    inline eid secondary (db::secondary index) const;
+
     // classify
     //  - parses entry and initializes members other than 'data'
     //
@@ -220,6 +265,21 @@ public:
         return { this->id, this->id };
     }
 
+    // indexed
+    //  - identity announcements are their own channel, nothing to index
+    //
+    static constexpr bool indexed = false;
+
+    // summarized
+    //  - no content 'type' is stored for these rows
+    //
+    static constexpr bool summarized = false;
+
+    // secondary
+    //  - returns key of this row in provided secondary index
+    //
+    inline eid secondary (db::secondary index) const;
+
     // classify
     //  - parses entry and initializes 'id'
     //
@@ -231,6 +291,40 @@ public:
     }
 };
 
+// summary_query
+//  - predicate over content summary ('type') of rows, composed with content::summary bitfields
+//  - row matches when bits selected by 'mask' equal those in 'value'
+//    and, if 'any' is nonzero, when at least one of 'any' bits is set
+//  - e.g. moderation only: 'any.mod' set to 'moderation::multiple' (all bits), votes only: 'any.vote'
+//    set to 'votes::multiple', unencrypted only: 'mask.encryption' all bits and 'value' zero
+//
+struct raddi::db::summary_query {
+    content::summary mask;
+    content::summary value;
+    content::summary any;
+
+public:
+
+    // matches
+    //  - evaluates the predicate for single row's summary
+    //
+    inline bool matches (const content::summary & type) const {
+        return ((type.raw & this->mask.raw) == (this->value.raw & this->mask.raw))
+            && (!this->any.raw || (type.raw & this->any.raw));
+    }
+
+    // possible
+    //  - evaluates the predicate against aggregated summaries of a set of rows
+    //     - 'some' - bits set in at least one row, 'every' - bits set in all rows
+    //  - returns false if no row of the set can match
+    //
+    inline bool possible (std::uint64_t some, std::uint64_t every) const {
+        return !(this->value.raw & this->mask.raw & ~some) // required bit is set in no row
+            && !(~this->value.raw & this->mask.raw & every) // bit required clear is set in every row
+            && (!this->any.raw || (this->any.raw & some));
+    }
+};
+
 // read
 //  - for 'get' function specifies what parts of the entry should be provided
 //  - internal parameter, actually a bitmask (would be nice to benefit from it though)
@@ -246,4 +340,41 @@ enum class raddi::db::read : unsigned int {
     everything                      = 0b111
 };
 
+// secondary
+//  - secondary indexes maintained by shards of tables with 'indexed' rows
+//  - channel - top level channel (or identity channel) the entry belongs to
+//  - thread - thread the entry belongs to (or the thread itself)
+//  - identity - author of the entry
+//
+enum class raddi::db::secondary : unsigned int {
+    channel = 0,
+    thread,
+    identity,
+};
+
+inline raddi::eid raddi::db::row::secondary (db::secondary index) const {
+    switch (index) {
+        case db::secondary::channel: return this->top_.channel;
+        case db::secondary::thread: return this->top_.thread;
+    }
+    return this->id.identity;
+}
+inline raddi::eid raddi::db::trow::secondary (db::secondary index) const {
+    switch (index) {
+        case db::secondary::channel: return this->parent;
+        case db::secondary::thread: return this->id;
+    }
+    return this->id.identity;
+}
+inline raddi::eid raddi::db::crow::secondary (db::secondary index) const {
+    switch (index) {
+        case db::secondary::channel:
+        case db::secondary::thread: return this->id;
+    }
+    return this->id.identity;
+}
+inline raddi::eid raddi::db::irow::secondary (db::secondary index) const {
+    return this->id;
+}
+
 #endif
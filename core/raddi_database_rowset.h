@@ -0,0 +1,235 @@
+#ifndef RADDI_DATABASE_ROWSET_H
+#define RADDI_DATABASE_ROWSET_H
+
+#include "raddi_database.h"
+#include <algorithm>
+#include <vector>
+
+// rowset
+//  - sorted set of rows (or secondary index items) with cheap out-of-order insertion
+//  - bulk of the data is in sorted 'run', rows that arrive out of order are inserted
+//    into small sorted 'tail' which is merged into 'run' once it reaches 'tail_limit'
+//  - iteration, lookup and positional access walk both sequences as if merged
+//  - T must be ordered by operator <, equal elements are not expected
+//
+template <typename T>
+class raddi::db::rowset {
+    std::vector <T> run;
+    std::vector <T> tail;
+
+public:
+
+    // tail_limit
+    //  - number of out-of-order rows kept aside before merging
+    //  - insertion into 'tail' moves at most this many rows, merge is linear
+    //
+    static constexpr std::size_t tail_limit = 256;
+
+    // const_iterator
+    //  - forward iterator visiting rows of 'run' and 'tail' in order
+    //
+    class const_iterator {
+        friend class rowset;
+
+        const T * a;
+        const T * ae;
+        const T * b;
+        const T * be;
+
+        const_iterator (const T * a, const T * ae, const T * b, const T * be)
+            : a (a), ae (ae), b (b), be (be) {}
+
+        bool in_run () const {
+            return (this->b == this->be)
+                || ((this->a != this->ae) && !(*this->b < *this->a));
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T *;
+        using reference = const T &;
+
+        const T & operator * () const { return this->in_run () ? *this->a : *this->b; }
+        const T * operator -> () const { return &**this; }
+
+        const_iterator & operator ++ () {
+            if (this->in_run ()) {
+                ++this->a;
+            } else {
+                ++this->b;
+            }
+            return *this;
+        }
+        const_iterator operator ++ (int) {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        bool operator == (const const_iterator & other) const { return this->a == other.a && this->b == other.b; }
+        bool operator != (const const_iterator & other) const { return this->a != other.a || this->b != other.b; }
+    };
+
+public:
+    std::size_t size () const { return this->run.size () + this->tail.size (); }
+    std::size_t capacity () const { return this->run.capacity (); }
+
+    // footprint
+    //  - bytes allocated by the rowset
+    //
+    std::size_t footprint () const { return (this->run.capacity () + this->tail.capacity ()) * sizeof (T); }
+    std::size_t max_size () const { return this->run.max_size (); }
+    bool empty () const { return this->run.empty () && this->tail.empty (); }
+
+    void reserve (std::size_t n) { this->run.reserve (n); }
+    void clear () {
+        this->run.clear ();
+        this->tail.clear ();
+    }
+    void shrink_to_fit () {
+        this->run.shrink_to_fit ();
+        this->tail.shrink_to_fit ();
+    }
+    void swap (rowset & other) {
+        this->run.swap (other.run);
+        this->tail.swap (other.tail);
+    }
+
+    const_iterator begin () const {
+        return const_iterator (this->run.data (), this->run.data () + this->run.size (),
+                               this->tail.data (), this->tail.data () + this->tail.size ());
+    }
+    const_iterator end () const {
+        return const_iterator (this->run.data () + this->run.size (), this->run.data () + this->run.size (),
+                               this->tail.data () + this->tail.size (), this->tail.data () + this->tail.size ());
+    }
+
+    // assign
+    //  - replaces content with already sorted vector of rows
+    //
+    void assign (std::vector <T> && sorted) {
+        this->run = std::move (sorted);
+        this->tail.clear ();
+    }
+
+    // insert
+    //  - appends in-order rows, others are placed into 'tail'
+    //
+    void insert (const T & row) {
+        if ((this->run.empty () || (this->run.back () < row))
+                && (this->tail.empty () || (this->tail.back () < row))) {
+            this->run.push_back (row);
+        } else {
+            this->tail.insert (std::lower_bound (this->tail.begin (), this->tail.end (), row), row);
+            if (this->tail.size () >= tail_limit) {
+                this->merge ();
+            }
+        }
+    }
+
+    // merge
+    //  - merges 'tail' into 'run'
+    //
+    void merge () {
+        if (!this->tail.empty ()) {
+            const auto middle = this->run.size ();
+            this->run.insert (this->run.end (), this->tail.begin (), this->tail.end ());
+            std::inplace_merge (this->run.begin (), this->run.begin () + middle, this->run.end ());
+            this->tail.clear ();
+        }
+    }
+
+    // lower_bound
+    //  - returns iterator to first row not less than 'probe'
+    //
+    const_iterator lower_bound (const T & probe) const {
+        const auto ae = this->run.data () + this->run.size ();
+        const auto be = this->tail.data () + this->tail.size ();
+        return const_iterator (std::lower_bound (this->run.data (), ae, probe), ae,
+                               std::lower_bound (this->tail.data (), be, probe), be);
+    }
+
+    // find
+    //  - returns pointer to row equal to 'probe' or nullptr if there is none
+    //
+    const T * find (const T & probe) const {
+        if (auto p = find (this->run, probe))
+            return p;
+        else
+            return find (this->tail, probe);
+    }
+
+    // erase
+    //  - removes row equal to 'probe', returns false if there was none
+    //
+    bool erase (const T & probe) {
+        return erase (this->run, probe)
+            || erase (this->tail, probe);
+    }
+
+    // back
+    //  - returns greatest row, set must not be empty
+    //
+    const T & back () const {
+        if (this->tail.empty () || (!this->run.empty () && (this->tail.back () < this->run.back ())))
+            return this->run.back ();
+        else
+            return this->tail.back ();
+    }
+
+    // operator []
+    //  - returns 'k'-th row in order, 'k' must be less than size ()
+    //  - finds partition of 'k' between 'run' and 'tail' with binary search
+    //
+    const T & operator [] (std::size_t k) const {
+        if (this->tail.empty ())
+            return this->run [k];
+        if (this->run.empty ())
+            return this->tail [k];
+
+        // i rows from 'run' and k - i from 'tail' precede the k-th row
+
+        std::size_t lo = (k > this->tail.size ()) ? k - this->tail.size () : 0;
+        std::size_t hi = std::min (k, this->run.size ());
+
+        while (lo < hi) {
+            const auto i = lo + (hi - lo) / 2;
+            if (this->run [i] < this->tail [k - i - 1]) {
+                lo = i + 1;
+            } else {
+                hi = i;
+            }
+        }
+
+        const auto i = lo;
+        const auto j = k - i;
+
+        if (j >= this->tail.size ())
+            return this->run [i];
+        if (i >= this->run.size ())
+            return this->tail [j];
+
+        return (this->tail [j] < this->run [i]) ? this->tail [j] : this->run [i];
+    }
+
+private:
+    static const T * find (const std::vector <T> & v, const T & probe) {
+        auto i = std::lower_bound (v.begin (), v.end (), probe);
+        if ((i != v.end ()) && !(probe < *i))
+            return &*i;
+        else
+            return nullptr;
+    }
+    static bool erase (std::vector <T> & v, const T & probe) {
+        auto i = std::lower_bound (v.begin (), v.end (), probe);
+        if ((i != v.end ()) && !(probe < *i)) {
+            v.erase (i);
+            return true;
+        } else
+            return false;
+    }
+};
+
+#endif
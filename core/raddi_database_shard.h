@@ -3,6 +3,11 @@
 
 #include "raddi_database.h"
 #include "raddi_database_row.h"
+#include "raddi_database_rowset.h"
+#include "raddi_database_bloom.h"
+#include "raddi_database_journal.h"
+#include "../common/mapping.h"
+#include <initializer_list>
 
 // shard
 //  - part of table determined by id.timestamp
@@ -18,6 +23,13 @@ class raddi::db::shard
     std::uint32_t   accessed; // timestamp of last access
     file            index;
     file            content;
+    mapping         content_map; // when db.settings.memory_mapped_shards, replaced only under exclusive lock
+
+    // broken
+    //  - set when reading data fails, possibly under shared lock where the shard can't be closed
+    //  - the shard is then closed and reloaded by next 'advance', see table::need_shard_to_advance
+    //
+    volatile bool   broken = false;
 
     // deleted
     //  - cached number of deleted entries
@@ -26,11 +38,53 @@ class raddi::db::shard
     //
     std::uint32_t   deleted;
 
+    // considered
+    //  - content file size when the shard was last found not worth compacting, see 'prepare'
+    //  - reset by changes that don't grow the content file (erase, repair, split)
+    //
+    std::uintmax_t  considered = 0;
+
+    // slotted
+    //  - cached row along with its slot, the ordinal number of the row in the index file
+    //  - allows erase to overwrite the row in index file directly, without searching
+    //
+    struct slotted : Key {
+        std::uint32_t slot;
+    };
+
     // cache
     //  - a primary index to the shard's data and positional information
-    //  - sorted from oldest to newest
+    //  - sorted from oldest to newest, out-of-order inserts are cheap, see 'rowset'
+    //
+    rowset <slotted> cache;
+
+    // secondary
+    //  - secondary indexes into 'cache', pairs of channel/thread/identity and row id, sorted
+    //  - maintained only for tables with Key::indexed rows, rebuilt whenever cache is loaded
+    //    from the index file (no separate file is kept), see 'db::secondary'
+    //
+    rowset <std::pair <eid, decltype (Key::id)>> secondary [3];
+
+    // filter
+    //  - Bloom filter of ids in the shard, kept in memory also after the shard is closed
+    //  - rebuilt when shard is loaded, saved to '.b' file when closed by writer
+    //  - loaded from '.b' by 'may_contain' for closed shards, only if it matches index file size
+    //  - 'filter_absent' remembers that loading failed, not attempted again until 'invalidate_filter'
+    //
+    bloom filter;
+    bool  filter_absent = false;
+
+    // aggregate
+    //  - content summaries of rows aggregated for tables with Key::summarized rows, see 'summary_query'
+    //     - 'some' has bits set in at least one row, 'every' bits set in all rows
+    //  - rebuilt when shard is loaded, erasing rows keeps both conservative (not narrowed)
+    //  - like 'filter' kept in memory after the shard is closed, 'known' is false until first loaded
     //
-    std::vector <Key> cache;
+    struct {
+        std::uint64_t some = 0;
+        std::uint64_t every = ~0uLL;
+        bool          known = false;
+    } aggregate;
 
 public:
     shard (std::uint32_t base, const db::table <Key> * = nullptr);
@@ -39,12 +93,39 @@ public:
 
     // close
     //  - frees shard cache and closes file handles
+    //  - if 'table' is provided, writer saves updated Bloom filter
     //
-    bool close ();
+    bool close (const db::table <Key> * table = nullptr);
     bool closed () const { return this->index.closed (); }
 
+    // may_contain
+    //  - consults Bloom filter without loading the shard, filter is loaded from disk if needed
+    //  - returns false only if the shard certainly doesn't contain 'entry'
+    //  - returns true for open shards (cache is searched then) or if there is no valid filter
+    //
+    bool may_contain (const db::table <Key> *, const decltype (Key::id) & entry);
+
+    // may_match
+    //  - consults aggregated content summaries without loading the shard
+    //  - returns false only if no row of the shard can match 'query'
+    //  - returns true if the summaries aren't known, i.e. the shard was not loaded yet
+    //
+    bool may_match (const summary_query & query) const;
+
+    // invalidate_filter
+    //  - discards Bloom filter and summary aggregate of closed shard after its index file changed (readers)
+    //
+    void invalidate_filter ();
+
+    // replaced
+    //  - returns true if the shard is open but its index file was meanwhile replaced
+    //    by different file (by writer's 'split' or 'compact')
+    //
+    bool replaced (const db::table <Key> *) const;
+
     // advance
     //  - loads new data added to shard by different process
+    //  - reloads the shard if it was marked 'broken'
     //
     bool advance (const db::table <Key> *);
 
@@ -63,6 +144,12 @@ public:
     //
     bool insert (const db::table <Key> *, const entry * data, std::size_t size, const root &, bool & exists);
 
+    // insert (batch)
+    //  - inserts 'n' entries, all new ones with single write to index and single write to content file
+    //  - returns number of entries inserted or already existing
+    //
+    std::size_t insert (const db::table <Key> *, insertion * const * items, std::size_t n);
+
     // erase
     //  - deletes entry from shard (overwrites with zeros actually)
     //  - if 'thorough' then also content is overwritten
@@ -103,6 +190,12 @@ public:
     //
     std::size_t size (const db::table <Key> *) const;
 
+    // footprint
+    //  - returns bytes of memory used by the loaded shard, 0 if closed
+    //  - row cache and secondary indexes, Bloom filter and mapped view of content file
+    //
+    std::size_t footprint () const;
+
     // top
     //  - retrieves key of latest (youngest) inserted entry (parameter)
     //  - returns false if shard is closed or empty
@@ -112,9 +205,55 @@ public:
     // split
     //  - splits a new shard containing entries as old as 'timestamp' or older
     //  - resulting shard can be empty
+    //  - both shards share the content file (hard link), only index files are rewritten
+    //     - if the link cannot be created, all entries are copied into new files instead
     //
     shard split (const db::table <Key> *, std::uint32_t timestamp);
 
+    // compaction
+    //  - rewrites content file to contain only data of rows in this shard's index
+    //    and index file with updated offsets; reclaims space of erased entries and
+    //    of content still shared with the other half after 'split'
+    //  - done in three steps by table::compact, so that the content is copied without any lock held:
+    //     - prepare - lists rows if at least 'threshold' percent of content file is not referenced,
+    //                 closed shard is loaded just for that and closed again
+    //     - copy - copies content of listed rows into 'content_copy' file, doesn't lock nor use
+    //              the shard state, called on temporary object of the same 'base'
+    //     - commit - copies rows appended since 'prepare', writes new index and replaces both files,
+    //                fails if the shard was rewritten meanwhile (by 'retire')
+    //
+    struct compaction {
+        std::vector <Key>               rows;       // ordered by content offset
+        std::vector <std::uintmax_t>    offsets;    // new offsets of 'rows', set by 'copy'
+        std::uintmax_t                  size = 0;   // content file size at 'prepare'
+        std::uintmax_t                  copied = 0; // size of 'content_copy' after 'copy'
+    };
+
+    bool prepare (const db::table <Key> *, unsigned int threshold, compaction &);
+    bool copy (const db::table <Key> *, compaction &) const;
+    bool commit (const db::table <Key> *, const compaction &);
+
+    // retire
+    //  - removes rows of the shard for which 'keep' returns false
+    //  - callback signature must be compatible with: bool f (const decltype (Key::id) &, const root &);
+    //  - when nothing is kept, shard files are deleted, otherwise compacted to retained rows only
+    //  - returns number of rows kept, or -1 on failure
+    //
+    template <typename F>
+    std::size_t retire (const db::table <Key> *, F keep);
+
+    // list/inspect/repair
+    //  - steps of table::verify, which runs its check without holding any lock
+    //  - list - loads the shard and copies all its rows, returns false if the shard cannot be loaded
+    //  - inspect - reads current row 'id' and its full entry into 'buffer', sets 'failure' if the row doesn't
+    //              point into content file or cannot be read; returns false if there is no such row (anymore)
+    //  - repair - erases rows 'ids' from index file and reloads the shard, rebuilding cache and indexes,
+    //             returns number of rows erased
+    //
+    bool list (const db::table <Key> *, std::vector <Key> & rows);
+    bool inspect (const db::table <Key> *, const decltype (Key::id) & id, Key * row, void * buffer, const wchar_t ** failure);
+    std::size_t repair (const db::table <Key> *, const std::vector <decltype (Key::id)> & ids);
+
     // enumerate
     //  - enumerates entries, calls callback with every 'row' that match
     //  - callback signature must be compatible with: bool f (const Key &, std::uint8_t *);
@@ -123,6 +262,14 @@ public:
     template <typename F>
     void enumerate (const db::table <Key> * table, F callback);
 
+    // enumerate
+    //  - enumerates only entries with 'key' in any of the 'indexes', calls callback as above
+    //  - rows are enumerated in order of ids for each index separately
+    //  - for tables without secondary indexes all rows are evaluated against 'key'
+    //
+    template <typename F>
+    void enumerate (const db::table <Key> * table, std::initializer_list <db::secondary> indexes, const eid & key, F callback);
+
 public:
     friend bool operator < (const shard & a, const shard & b) { return a.base < b.base; }
     friend bool operator < (const shard & a, const std::uint32_t & b) { return a.base < b; }
@@ -134,19 +281,64 @@ private:
         content,
         index_log,
         content_log,
+        index_commit,
+        content_copy,
+        filter,
     };
 
     std::wstring path (const db::table <Key> *, stream stream = stream::index) const;
 
+    // remap_threshold
+    //  - content appended after 'content_map' was created is read from the file directly
+    //    until at least this many bytes accumulate, then the file is remapped
+    //
+    static constexpr std::uintmax_t remap_threshold = 65536;
+
+    // unsynchronized_remap
+    //  - maps content file of 'size' bytes again, if not mapped yet or if grown past 'remap_threshold'
+    //  - requires exclusive lock, readers holding shared lock may be reading from the current view
+    //  - called on 'advance' (readers see appended data) and after 'insert' (writer)
+    //
+    void unsynchronized_remap (std::uintmax_t size);
+
     void unsynchronized_close ();
+    void unsynchronized_unload (const db::table <Key> *);
+    std::size_t unsynchronized_footprint () const;
     bool unsynchronized_advance (const db::table <Key> *);
-    void unsynchronized_insert_to_cache (const Key &);
+    void unsynchronized_insert_to_cache (const Key &, std::uint32_t slot);
+    void unsynchronized_erase_from_cache (const Key &);
+    void unsynchronized_rebuild_secondary ();
+    void unsynchronized_aggregate (const Key &);
+    void unsynchronized_update_filter (const db::table <Key> *);
+    void unsynchronized_save_filter (const db::table <Key> *);
 
     bool unsynchronized_get (const db::table <Key> *, const decltype (Key::id) &, Key * = nullptr,
                              read = read::nothing, void * = nullptr, std::size_t * = nullptr, std::size_t = 0u);
-    bool unsynchronized_read (const db::table <Key> *, typename std::vector <Key>::const_iterator i,
+    bool unsynchronized_read (const db::table <Key> *, const Key & row,
                               read = read::nothing, void * = nullptr, std::size_t = 0u);
+    bool unsynchronized_read_content (const db::table <Key> *, std::uintmax_t position, void * target, std::size_t length);
+    bool unsynchronized_exists (const db::table <Key> *, const entry * data, std::size_t size, bool & exists);
     bool unsynchronized_insert (const db::table <Key> *, const entry * data, std::size_t size, const root &);
+    std::size_t unsynchronized_insert (const db::table <Key> *, insertion * const * items, std::size_t n);
+
+    bool unsynchronized_split_index (const db::table <Key> *, shard & separated, std::uint32_t timestamp);
+    shard unsynchronized_split_copy (const db::table <Key> *, std::uint32_t timestamp);
+    bool write_index (const std::wstring & path, std::vector <slotted> rows);
+    bool unsynchronized_rewrite (const db::table <Key> *, std::uintmax_t used, std::uintmax_t size);
+
+    // unsynchronized_commit
+    //  - replaces shard files with 'rows' and content already written to 'content_log' file
+    //  - 'used' and 'size' are new and original content file sizes, for reporting
+    //
+    bool unsynchronized_commit (const db::table <Key> *, std::vector <slotted> & rows, std::uintmax_t used, std::uintmax_t size);
+
+    // unsynchronized_recover
+    //  - finishes 'unsynchronized_rewrite' that was committed (index renamed to 'index_commit')
+    //    but interrupted before both files were moved into place; called when opening the shard
+    //  - returns false if the rewrite is still pending, always for readers, they wait for the writer
+    //
+    bool unsynchronized_recover (const db::table <Key> *);
+    std::uintmax_t unsynchronized_used () const;
 };
 
 #include "raddi_database_shard.tcc"
@@ -11,6 +11,9 @@ std::wstring raddi::db::shard <Key>::path (const db::table <Key> * table, stream
         case stream::content: suffix = L"d"; break;
         case stream::index_log: suffix = L"i~"; break; //  + std::to_wstring (raddi::microtimestamp ());
         case stream::content_log: suffix = L"d~"; break; //  + std::to_wstring (raddi::microtimestamp ());
+        case stream::index_commit: suffix = L"i+"; break;
+        case stream::content_copy: suffix = L"d+"; break;
+        case stream::filter: suffix = L"b"; break;
     }
 
     wchar_t filename [32768];
@@ -35,8 +38,14 @@ raddi::db::shard <Key>::shard (raddi::db::shard <Key> && other)
     , accessed (raddi::now ())
     , index (std::move (other.index))
     , content (std::move (other.content))
+    , content_map (std::move (other.content_map))
     , cache (std::move (other.cache))
-    , deleted (other.deleted) {}
+    , secondary { std::move (other.secondary [0]), std::move (other.secondary [1]), std::move (other.secondary [2]) }
+    , filter (std::move (other.filter))
+    , filter_absent (other.filter_absent)
+    , aggregate (other.aggregate)
+    , deleted (other.deleted)
+    , considered (other.considered) {}
 
 template <typename Key>
 raddi::db::shard <Key> & raddi::db::shard <Key>::operator = (raddi::db::shard <Key> && other) {
@@ -48,29 +57,185 @@ raddi::db::shard <Key> & raddi::db::shard <Key>::operator = (raddi::db::shard <K
     this->accessed = other.accessed;
     this->index = std::move (other.index);
     this->content = std::move (other.content);
+    this->content_map = std::move (other.content_map);
     this->cache.swap (other.cache);
+    for (auto i = 0u; i != sizeof this->secondary / sizeof this->secondary [0]; ++i) {
+        this->secondary [i].swap (other.secondary [i]);
+    }
+    this->filter = std::move (other.filter);
+    this->filter_absent = other.filter_absent;
+    this->aggregate = other.aggregate;
     this->deleted = other.deleted;
+    this->considered = other.considered;
     return *this;
 }
 
 template <typename Key>
 void raddi::db::shard <Key>::unsynchronized_close () {
     this->cache.clear ();
+    for (auto & index : this->secondary) {
+        index.clear ();
+    }
+    this->content_map.close ();
     this->index.close ();
     this->content.close ();
+    this->broken = false;
+}
+
+template <typename Key>
+std::size_t raddi::db::shard <Key>::footprint () const {
+    immutability guard (this->lock);
+    return this->unsynchronized_footprint ();
+}
+
+template <typename Key>
+std::size_t raddi::db::shard <Key>::unsynchronized_footprint () const {
+    if (this->index.closed ())
+        return 0;
+
+    std::size_t bytes = this->cache.footprint () + this->filter.footprint ();
+    for (const auto & index : this->secondary) {
+        bytes += index.footprint ();
+    }
+    return bytes + (std::size_t) this->content_map.size ();
 }
 
 template <typename Key>
-bool raddi::db::shard <Key>::close () {
+bool raddi::db::shard <Key>::close (const db::table <Key> * table) {
     if (!this->closed ()) {
         exclusive guard (this->lock);
-        this->unsynchronized_close ();
-        this->cache.shrink_to_fit ();
+        this->unsynchronized_unload (table);
         return true;
     } else
         return false;
 }
 
+template <typename Key>
+void raddi::db::shard <Key>::unsynchronized_unload (const db::table <Key> * table) {
+    if (table) {
+        this->unsynchronized_save_filter (table);
+
+        // journaled appends must reach the disk before the journal is checkpointed
+        if (table->db.mode == file::access::write) {
+            this->flush ();
+        }
+    }
+    this->unsynchronized_close ();
+    this->cache.shrink_to_fit ();
+    for (auto & index : this->secondary) {
+        index.shrink_to_fit ();
+    }
+}
+
+template <typename Key>
+bool raddi::db::shard <Key>::may_contain (const db::table <Key> * table, const decltype (Key::id) & id) {
+    if (!table->db.settings.bloom_filter_bits)
+        return true;
+
+    // common case, open shard or filter already loaded (or known to be missing)
+
+    {
+        immutability guard (this->lock);
+        if (!this->index.closed ())
+            return true;
+        if (!this->filter.empty ())
+            return this->filter.contains (id);
+        if (this->filter_absent)
+            return true;
+    }
+
+    exclusive guard (this->lock);
+    if (!this->index.closed ())
+        return true;
+
+    if (this->filter.empty () && !this->filter_absent) {
+
+        // load only filter matching current index file size, otherwise it might miss rows
+
+        file f;
+        file i;
+        if (f.open (this->path (table, stream::filter), file::mode::open, file::access::read, file::share::full, file::buffer::sequential)
+                && i.open (this->path (table, stream::index), file::mode::open, file::access::query, file::share::full)) {
+
+            if (!this->filter.load (f) || (this->filter.covers != i.size ())) {
+                this->filter.clear ();
+            }
+        }
+        this->filter_absent = this->filter.empty ();
+    }
+    return this->filter.empty ()
+        || this->filter.contains (id);
+}
+
+template <typename Key>
+bool raddi::db::shard <Key>::may_match (const summary_query & query) const {
+    if constexpr (Key::summarized) {
+        immutability guard (this->lock);
+        return !this->aggregate.known
+            || query.possible (this->aggregate.some, this->aggregate.every);
+    } else
+        return true;
+}
+
+template <typename Key>
+void raddi::db::shard <Key>::invalidate_filter () {
+    exclusive guard (this->lock);
+    if (this->index.closed ()) {
+        this->filter.clear ();
+        this->filter_absent = false;
+        this->aggregate.known = false;
+    }
+}
+
+template <typename Key>
+void raddi::db::shard <Key>::unsynchronized_update_filter (const db::table <Key> * table) {
+    if (table->db.settings.bloom_filter_bits) {
+        if (this->filter.empty () || this->filter.full ()) {
+            this->filter.reset (std::max <std::size_t> (2 * this->cache.size (), table->db.settings.maximum_shard_size),
+                                table->db.settings.bloom_filter_bits);
+
+            for (const auto & row : this->cache) {
+                this->filter.insert (row.id);
+            }
+        }
+        this->filter.covers = this->index.tell ();
+        this->filter_absent = false;
+    }
+}
+
+template <typename Key>
+void raddi::db::shard <Key>::unsynchronized_save_filter (const db::table <Key> * table) {
+    if (table->db.settings.bloom_filter_bits
+            && (table->db.mode == file::access::write)
+            && this->filter.dirty
+            && !this->filter.empty ()
+            && !this->index.closed ()) {
+
+        const auto path = this->path (table, stream::filter);
+
+        file f;
+        if (f.create (path) && this->filter.save (f)) {
+            this->filter.dirty = false;
+        } else {
+            this->report (log::level::error, 28, path);
+            f.close ();
+            DeleteFile (path.c_str ());
+        }
+    }
+}
+
+template <typename Key>
+bool raddi::db::shard <Key>::replaced (const db::table <Key> * table) const {
+    immutability guard (this->lock);
+    if (!this->index.closed ()) {
+
+        file f;
+        if (f.open (this->path (table), file::mode::open, file::access::query, file::share::full))
+            return f.identity () != this->index.identity ();
+    }
+    return false;
+}
+
 template <typename Key>
 void raddi::db::shard <Key>::flush () {
     this->content.flush ();
@@ -80,6 +245,10 @@ void raddi::db::shard <Key>::flush () {
 template <typename Key>
 bool raddi::db::shard <Key>::advance (const db::table <Key> * table) {
     exclusive guard (this->lock);
+    if (this->broken) {
+        this->broken = false;
+        this->unsynchronized_close ();
+    }
     return this->unsynchronized_advance (table);
 }
 
@@ -153,6 +322,9 @@ bool raddi::db::shard <Key>::unsynchronized_advance (const db::table <Key> * tab
     }
 
     if (this->index.closed ()) {
+        if (!this->unsynchronized_recover (table))
+            return false;
+
         auto path = this->path (table, stream::index);
         if (this->index.open (path, open, table->db.mode, share, file::buffer::sequential)) {
             if ((open == file::mode::always) && this->index.created ()) {
@@ -161,6 +333,10 @@ bool raddi::db::shard <Key>::unsynchronized_advance (const db::table <Key> * tab
                 this->report (log::level::note, 12, path);
             }
             opened = true;
+
+            this->aggregate.some = 0;
+            this->aggregate.every = ~0uLL;
+            this->aggregate.known = true;
         } else {
             this->report (log::level::error, 11, path, table->db.mode, share);
             return false;
@@ -171,6 +347,7 @@ bool raddi::db::shard <Key>::unsynchronized_advance (const db::table <Key> * tab
         auto path = this->path (table, stream::content);
         if (this->content.open (path, open, table->db.mode, share, file::buffer::random)) {
             this->content.tail ();
+
         } else {
             this->report (log::level::error, 12, path, table->db.mode, share);
             this->index.close ();
@@ -180,6 +357,10 @@ bool raddi::db::shard <Key>::unsynchronized_advance (const db::table <Key> * tab
 
     this->accessed = raddi::now ();
 
+    if (table->db.settings.memory_mapped_shards) {
+        this->unsynchronized_remap (this->content.size ());
+    }
+
     try {
         const auto size = this->index.size ();
         const auto n = std::size_t (size / sizeof (Key));
@@ -208,18 +389,44 @@ bool raddi::db::shard <Key>::unsynchronized_advance (const db::table <Key> * tab
                 this->cache.reserve (std::max (reserve, 4096 / sizeof (Key))); // 16384?
             }
 
+            // view
+            //  - index is read through mapped view only while loading, rows are then kept in 'cache'
+            //
+            mapping view;
+            if (table->db.settings.memory_mapped_shards) {
+                view.map (this->index);
+            }
+
             if (opened) { // TODO: measure if we need this path at all since this is likely i/o bound anyway
-                this->cache.resize (n);
+                std::vector <Key> rows;
+                rows.reserve (std::max (n, this->cache.capacity ()));
+                rows.resize (n);
+
+                if (view.read (0, &rows [0], n * sizeof (Key))
+                        ? this->index.seek (n * sizeof (Key)) != (std::uintmax_t) -1
+                        : this->index.read (&rows [0], n * sizeof (Key))) {
+                    std::vector <slotted> slots;
+                    slots.reserve (rows.capacity ());
+
+                    this->deleted = 0;
+                    for (std::size_t i = 0; i != n; ++i) {
+                        if (rows [i].id.erased ()) {
+                            ++this->deleted;
+                        } else {
+                            slots.push_back ({ rows [i], (std::uint32_t) i });
+                            this->unsynchronized_aggregate (rows [i]);
+                        }
+                    }
 
-                if (this->index.read (&this->cache [0], n * sizeof (Key))) {
-                    std::sort (this->cache.begin (), this->cache.end ());
+                    rows.clear ();
+                    rows.shrink_to_fit ();
 
-                    // erased keys got moved to front
-                    auto first_valid = std::find_if_not (this->cache.begin (), this->cache.end (),
-                                                         [](auto & x) { return x.id.erased (); });
+                    std::sort (slots.begin (), slots.end ());
+                    this->cache.assign (std::move (slots));
+                    this->unsynchronized_rebuild_secondary ();
 
-                    this->deleted = (std::uint32_t) std::distance (this->cache.begin (), first_valid);
-                    this->cache.erase (this->cache.begin (), first_valid);
+                    this->filter.clear ();
+                    this->unsynchronized_update_filter (table);
                 }
             } else {
                 this->cache.reserve (n);
@@ -228,13 +435,28 @@ bool raddi::db::shard <Key>::unsynchronized_advance (const db::table <Key> * tab
                 Key row;
                 std::memset (&row, 0, sizeof row);
 
-                while (this->index.read (row)) {
-                    if (row.id.erased ()) {
-                        ++this->deleted;
-                    } else {
-                        this->unsynchronized_insert_to_cache (row);
+                auto offset = this->index.tell ();
+                if (view.data (offset, sizeof row)) {
+                    while (view.read (offset, row)) {
+                        if (row.id.erased ()) {
+                            ++this->deleted;
+                        } else {
+                            this->unsynchronized_insert_to_cache (row, (std::uint32_t) (offset / sizeof row));
+                        }
+                        offset += sizeof row;
+                    }
+                    this->index.seek (offset);
+                } else {
+                    while (this->index.read (row)) {
+                        if (row.id.erased ()) {
+                            ++this->deleted;
+                        } else {
+                            this->unsynchronized_insert_to_cache (row, (std::uint32_t) (offset / sizeof row));
+                        }
+                        offset += sizeof row;
                     }
                 }
+                this->unsynchronized_update_filter (table);
             }
             this->report (log::level::note, 13, this->cache.size ());
         }
@@ -246,18 +468,54 @@ bool raddi::db::shard <Key>::unsynchronized_advance (const db::table <Key> * tab
 }
 
 template <typename Key>
-void raddi::db::shard <Key>::unsynchronized_insert_to_cache (const Key & r) {
-    if (this->cache.empty () || (this->cache.back ().id < r.id)) {
-        this->cache.push_back (r);
-    } else {
-        this->cache.insert (std::lower_bound (this->cache.begin (), this->cache.end (), r), r);
+void raddi::db::shard <Key>::unsynchronized_insert_to_cache (const Key & r, std::uint32_t slot) {
+    this->cache.insert ({ r, slot });
+    this->filter.insert (r.id);
+    this->unsynchronized_aggregate (r);
+
+    if constexpr (Key::indexed) {
+        for (auto i = 0u; i != sizeof this->secondary / sizeof this->secondary [0]; ++i) {
+            this->secondary [i].insert ({ r.secondary ((db::secondary) i), r.id });
+        }
     }
 }
 
 template <typename Key>
-bool raddi::db::shard <Key>::insert (const db::table <Key> * table, const entry * entry, std::size_t size, const root & top, bool & exists) {
-    exclusive guard (this->lock);
+void raddi::db::shard <Key>::unsynchronized_erase_from_cache (const Key & row) {
+    if constexpr (Key::indexed) {
+        for (auto i = 0u; i != sizeof this->secondary / sizeof this->secondary [0]; ++i) {
+            this->secondary [i].erase ({ row.secondary ((db::secondary) i), row.id });
+        }
+    }
+    this->cache.erase ({ row });
+}
+
+template <typename Key>
+void raddi::db::shard <Key>::unsynchronized_aggregate (const Key & row) {
+    if constexpr (Key::summarized) {
+        this->aggregate.some |= row.type.raw;
+        this->aggregate.every &= row.type.raw;
+    }
+}
+
+template <typename Key>
+void raddi::db::shard <Key>::unsynchronized_rebuild_secondary () {
+    if constexpr (Key::indexed) {
+        for (auto i = 0u; i != sizeof this->secondary / sizeof this->secondary [0]; ++i) {
+            std::vector <std::pair <eid, decltype (Key::id)>> index;
+            index.reserve (this->cache.capacity ());
+
+            for (const auto & row : this->cache) {
+                index.emplace_back (row.secondary ((db::secondary) i), row.id);
+            }
+            std::sort (index.begin (), index.end ());
+            this->secondary [i].assign (std::move (index));
+        }
+    }
+}
 
+template <typename Key>
+bool raddi::db::shard <Key>::unsynchronized_exists (const db::table <Key> * table, const entry * entry, std::size_t size, bool & exists) {
     if (!table->db.settings.reinsertion_validation) {
         exists = this->unsynchronized_get (table, (const decltype (Key::id)) entry->id);
 
@@ -276,79 +534,189 @@ bool raddi::db::shard <Key>::insert (const db::table <Key> * table, const entry
             }
         }
     }
+    return true;
+}
+
+template <typename Key>
+bool raddi::db::shard <Key>::insert (const db::table <Key> * table, const entry * entry, std::size_t size, const root & top, bool & exists) {
+    exclusive guard (this->lock);
+
+    if (!this->unsynchronized_exists (table, entry, size, exists))
+        return false;
 
     return exists
         || this->unsynchronized_insert (table, entry, size, top);
 }
 
+template <typename Key>
+std::size_t raddi::db::shard <Key>::insert (const db::table <Key> * table, insertion * const * items, std::size_t n) {
+    exclusive guard (this->lock);
+
+    std::size_t m = 0;
+    std::vector <insertion *> fresh;
+    fresh.reserve (n);
+
+    for (std::size_t i = 0; i != n; ++i) {
+        auto item = items [i];
+        item->inserted = false;
+
+        if (this->unsynchronized_exists (table, item->entry, item->size, item->exists)) {
+            if (item->exists) {
+                ++m;
+            } else {
+                fresh.push_back (item);
+            }
+        }
+    }
+
+    // duplicates within the batch itself
+    //  - keeping first, others are reported as existing
+
+    std::stable_sort (fresh.begin (), fresh.end (),
+                      [] (const insertion * a, const insertion * b) { return a->entry->id < b->entry->id; });
+    auto last = std::unique (fresh.begin (), fresh.end (),
+                             [] (const insertion * a, const insertion * b) { return a->entry->id == b->entry->id; });
+
+    for (auto i = last; i != fresh.end (); ++i) {
+        (*i)->exists = true;
+        ++m;
+    }
+    fresh.erase (last, fresh.end ());
+
+    return m + this->unsynchronized_insert (table, fresh.data (), fresh.size ());
+}
+
 template <typename Key>
 bool raddi::db::shard <Key>::unsynchronized_insert (const db::table <Key> * table, const entry * entry, std::size_t size, const root & top) {
-    if (size >= sizeof (raddi::entry) + raddi::proof::min_size
-     && size <= sizeof (raddi::entry) + raddi::entry::max_content_size) {
+    insertion item;
+    item.entry = entry;
+    item.size = size;
+    item.top = top;
 
-        if (this->unsynchronized_advance (table)) {
+    auto p = &item;
+    return this->unsynchronized_insert (table, &p, 1) == 1;
+}
 
-            // TODO: use file locking to protect readers against shard splits?
-            // TODO: move content data generation (pointer offsetting) and complete row (Key) initialization to 'row'
-            //       Key::content (...) -> ptr/size to write, classify -> initialize, will also set offset/length
+template <typename Key>
+std::size_t raddi::db::shard <Key>::unsynchronized_insert (const db::table <Key> * table, insertion * const * items, std::size_t n) {
+    if (n == 0 || !this->unsynchronized_advance (table))
+        return 0;
 
-            const auto prefix = sizeof (raddi::entry::id) + sizeof (raddi::entry::parent);
-            const auto iposition = this->index.tell ();
-            const auto cposition = this->content.tell ();
+    // TODO: use file locking to protect readers against shard splits?
+    // TODO: move content data generation (pointer offsetting) and complete row (Key) initialization to 'row'
+    //       Key::content (...) -> ptr/size to write, classify -> initialize, will also set offset/length
 
-            const void * write_ptr = nullptr;
-            const auto   write_size = size - prefix;
-            std::uint8_t masked [sizeof (raddi::entry) + raddi::entry::max_content_size];
+    // content file may be shared with other shard after 'split', thus always append to its end
 
-            if (const auto mask_size = table->db.mask.size ()) {
-                const auto source = reinterpret_cast <const std::uint8_t *> (entry) + prefix;
+    const auto prefix = sizeof (raddi::entry::id) + sizeof (raddi::entry::parent);
+    const auto iposition = this->index.tell ();
+    const auto cposition = this->content.tail ();
 
-                for (auto i = 0u; i != write_size; ++i) {
-                    masked [i] = source [i] ^ table->db.mask [(cposition + i) % mask_size];
-                }
+    std::vector <Key> rows;
+    std::vector <std::uint8_t> content;
+    std::vector <insertion *> written;
 
-                write_ptr = masked;
-            } else {
-                write_ptr = reinterpret_cast <const char *> (entry) + prefix;
+    try {
+        std::size_t total = 0;
+        for (std::size_t i = 0; i != n; ++i) {
+            const auto size = items [i]->size;
+            if (size >= sizeof (raddi::entry) + raddi::proof::min_size
+             && size <= sizeof (raddi::entry) + raddi::entry::max_content_size) {
+                total += size - prefix;
             }
+        }
 
-            if (!this->content.write (write_ptr, write_size)) {
-                this->content.resize (cposition);
-                return this->report (log::level::error, 15, this->path (table));
-            }
+        rows.reserve (n);
+        written.reserve (n);
+        content.reserve (total);
 
-            Key row;
-            if (row.classify (entry, size, top)) {
-                row.data.offset = cposition;
-                row.data.length = size - sizeof (raddi::entry);
+        // classify all and build masked content
+        //  - single entry single write, thus entries failing validation are simply skipped
 
-                if (!this->index.write (row)) {
-                    this->index.resize (iposition);
-                    this->content.resize (cposition);
-                    return this->report (log::level::error, 14, this->path (table));
-                }
+        for (std::size_t i = 0; i != n; ++i) {
+            const auto entry = items [i]->entry;
+            const auto size = items [i]->size;
 
-                try {
-                    this->unsynchronized_insert_to_cache (row);
-                    this->accessed = raddi::now ();
-
-                    this->report (log::level::note, 14, this->path (table), row.id);
-                    return true;
-                } catch (const std::bad_alloc &) {
-                    try {
-                        this->report (log::level::error, 16, this->path (table));
-                        this->unsynchronized_close ();
-                        this->cache.shrink_to_fit ();
-                    } catch (const std::bad_alloc &) {
-                        // not much to try here
-                    }
+            if (size >= sizeof (raddi::entry) + raddi::proof::min_size
+             && size <= sizeof (raddi::entry) + raddi::entry::max_content_size) {
+
+                Key row;
+                if (row.classify (entry, size, items [i]->top)) {
+                    const auto offset = content.size ();
+
+                    row.data.offset = cposition + offset;
+                    row.data.length = size - sizeof (raddi::entry);
+
+                    content.resize (offset + size - prefix);
+                    table->db.xor_mask (&content [offset], reinterpret_cast <const std::uint8_t *> (entry) + prefix,
+                                        size - prefix, cposition + offset);
+
+                    rows.push_back (row);
+                    written.push_back (items [i]);
+                } else {
+                    this->report (log::level::error, 24, this->path (table), row.id, size);
                 }
-            } else {
-                this->report (log::level::error, 24, this->path (table), row.id, size);
             }
         }
+    } catch (const std::bad_alloc &) {
+        this->report (log::level::error, 16, this->path (table));
+        return 0;
     }
-    return false;
+
+    if (rows.empty ())
+        return 0;
+
+    // journal first, the files are then flushed only periodically, see 'journal'
+
+    journal::record record;
+    record.base = this->base;
+    record.index_length = (std::uint32_t) (rows.size () * sizeof (Key));
+    record.content_length = (std::uint32_t) content.size ();
+    record.reserved = 0;
+    record.index_position = iposition;
+    record.content_position = cposition;
+
+    if (!table->write_ahead (record, rows.data (), content.data ()))
+        return 0;
+
+    if (!this->content.write (content.data (), content.size ())) {
+        this->content_map.close ();
+        this->content.resize (cposition);
+        return this->report (log::level::error, 15, this->path (table));
+    }
+    if (!this->index.write (rows.data (), rows.size () * sizeof (Key))) {
+        this->content_map.close ();
+        this->index.resize (iposition);
+        this->content.resize (cposition);
+        return this->report (log::level::error, 14, this->path (table));
+    }
+
+    try {
+        for (std::size_t i = 0; i != rows.size (); ++i) {
+            this->unsynchronized_insert_to_cache (rows [i], (std::uint32_t) (iposition / sizeof (Key) + i));
+            this->report (log::level::note, 14, this->path (table), rows [i].id);
+
+            written [i]->exists = false;
+            written [i]->inserted = true;
+        }
+        this->unsynchronized_update_filter (table);
+        this->accessed = raddi::now ();
+
+        if (table->db.settings.memory_mapped_shards) {
+            this->unsynchronized_remap (cposition + content.size ());
+        }
+        return rows.size ();
+
+    } catch (const std::bad_alloc &) {
+        try {
+            this->report (log::level::error, 16, this->path (table));
+            this->unsynchronized_close ();
+            this->cache.shrink_to_fit ();
+        } catch (const std::bad_alloc &) {
+            // not much to try here
+        }
+    }
+    return 0;
 }
 
 template <typename Key>
@@ -356,31 +724,32 @@ bool raddi::db::shard <Key>::erase (const db::table <Key> * table, const decltyp
     exclusive guard (this->lock);
 
     if (this->unsynchronized_advance (table)) {
-        auto ie = this->cache.end ();
-        auto ii = std::lower_bound (this->cache.begin (), ie, Key { id });
-        if ((ii != ie) && (ii->id == id)) {
+        if (auto ii = this->cache.find ({ Key { id } })) {
 
             if (thorough) {
                 const auto length = ii->data.length + sizeof (raddi::entry::signature);
+
+                this->content_map.close (); // zeroing range of mapped file fails on Windows, remapped on next insert
                 if (!this->content.zero (ii->data.offset, length)) {
                     this->report (log::level::error, 19, this->path (table, stream::content), ii->data.offset, length);
                 }
             }
 
-            raddi::eid i;
-            std::uintmax_t offset = 0;
+            // row is overwritten directly in its slot, id there is verified first
 
-            while (this->index.read (offset, i)) {
-                if (!i.erased () && (i == id)) {
-                    if (!this->index.zero (offset, sizeof (Key))) {
-                        return this->report (log::level::error, 20, this->path (table), offset, sizeof (Key));
-                    } else
-                        break;
-                }
-                offset += sizeof (Key);
+            decltype (Key::id) i;
+            const auto offset = std::uintmax_t (ii->slot) * sizeof (Key);
+
+            if (!this->index.read (offset, i) || (i != id)) {
+                return this->report (log::level::error, 26, this->path (table), ii->slot, id);
+            }
+            if (!this->index.zero (offset, sizeof (Key))) {
+                return this->report (log::level::error, 20, this->path (table), offset, sizeof (Key));
             }
 
-            this->cache.erase (ii);
+            this->unsynchronized_erase_from_cache (Key (*ii));
+            ++this->deleted;
+            this->considered = 0;
             return true;
         }
     }
@@ -406,14 +775,14 @@ bool raddi::db::shard <Key>::get (const db::table <Key> * table,
     immutability guard (this->lock);
 
     if (index < this->cache.size ()) {
-        auto ii = this->cache.begin () + index;
+        const auto & row = this->cache [index];
 
         if (size) {
-            *size = (std::size_t) ii->data.length + sizeof (raddi::entry);
+            *size = (std::size_t) row.data.length + sizeof (raddi::entry);
         }
 
         this->accessed = raddi::now ();
-        return this->unsynchronized_read (table, ii, what, buffer, demand);
+        return this->unsynchronized_read (table, row, what, buffer, demand);
     } else
         return false;
 }
@@ -422,9 +791,7 @@ template <typename Key>
 bool raddi::db::shard <Key>::unsynchronized_get (const db::table <Key> * table,
                                                  const decltype (Key::id) & id, Key * row,
                                                  read what, void * entry, std::size_t * size, std::size_t demand) {
-    auto ie = this->cache.end ();
-    auto ii = std::lower_bound (this->cache.begin (), ie, Key { id });
-    if ((ii != ie) && (ii->id == id)) {
+    if (auto ii = this->cache.find ({ Key { id } })) {
 
         if (row) {
             *row = *ii;
@@ -434,14 +801,14 @@ bool raddi::db::shard <Key>::unsynchronized_get (const db::table <Key> * table,
         }
 
         this->accessed = raddi::now ();
-        return this->unsynchronized_read (table, ii, what, entry, demand);
+        return this->unsynchronized_read (table, *ii, what, entry, demand);
     } else
         return false;
 }
 
 template <typename Key>
 bool raddi::db::shard <Key>::unsynchronized_read (const db::table <Key> * table,
-                                                  typename std::vector <Key>::const_iterator ii,
+                                                  const Key & row,
                                                   read what, void * entry, std::size_t demand) {
     if ((what != read::nothing) && (entry != nullptr)) {
         switch (what) {
@@ -449,16 +816,16 @@ bool raddi::db::shard <Key>::unsynchronized_read (const db::table <Key> * table,
             case read::identification_and_verification:
             case read::identification_and_content:
             case read::everything:
-                *reinterpret_cast <raddi::entry *> (entry) = (raddi::entry) *ii;
+                *reinterpret_cast <raddi::entry *> (entry) = (raddi::entry) row;
                 break;
         }
 
-        if (demand > ii->data.length) {
-            this->unsynchronized_close ();
+        if (demand > row.data.length) {
+            this->broken = true;
             return false; // TODO: report? unable to serve demanded amount of content, internal error or db corrupted
         }
         if (demand == 0) {
-            demand = ii->data.length;
+            demand = row.data.length;
         }
 
         std::size_t length = 0;
@@ -487,29 +854,128 @@ bool raddi::db::shard <Key>::unsynchronized_read (const db::table <Key> * table,
         auto target = reinterpret_cast <std::uint8_t *> (entry)
                     + sizeof (raddi::entry::id) + sizeof (raddi::entry::parent)
                     + offset;
-        auto position = ii->data.offset + offset;
-
-        if (this->content.read (position, target, length)) {
+        auto position = row.data.offset + offset;
 
-            if (auto mask_size = table->db.mask.size ()) {
-                for (auto i = 0u; i != length; ++i) {
-                    target [i] ^= table->db.mask [(position + i) % mask_size];
-                }
-            }
+        if (this->unsynchronized_read_content (table, position, target, length)) {
+            table->db.xor_mask (target, target, length, position);
         } else {
             this->report (log::level::error, 17, position, length);
-            this->unsynchronized_close (); // corrupted db, force reload
+            this->broken = true; // corrupted db, force reload
             return false;
         }
     }
     return true;
 }
 
+template <typename Key>
+bool raddi::db::shard <Key>::unsynchronized_read_content (const db::table <Key> * table,
+                                                          std::uintmax_t position, void * target, std::size_t length) {
+
+    // data appended since mapping (or file was empty) are read directly
+    //  - the view is never replaced here, other readers may be copying from it, see 'unsynchronized_remap'
+
+    if (table->db.settings.memory_mapped_shards && this->content_map.read (position, target, length))
+        return true;
+    else
+        return this->content.read (position, target, length);
+}
+
+template <typename Key>
+void raddi::db::shard <Key>::unsynchronized_remap (std::uintmax_t size) {
+    if ((size != (std::uintmax_t) -1) && (size != 0)) {
+        if (this->content_map.closed () || (size >= this->content_map.size () + remap_threshold)) {
+            this->content_map.map (this->content);
+        }
+    }
+}
+
 template <typename Key>
 raddi::db::shard <Key> raddi::db::shard <Key>::split (const db::table <Key> * table, std::uint32_t timestamp) {
     exclusive guard (this->lock);
     this->report (log::level::note, 15, timestamp);
+    this->considered = 0;
 
+    if (this->unsynchronized_advance (table)) {
+        shard separated (timestamp, table);
+        if (this->unsynchronized_split_index (table, separated, timestamp))
+            return separated;
+    }
+    return this->unsynchronized_split_copy (table, timestamp);
+}
+
+template <typename Key>
+bool raddi::db::shard <Key>::unsynchronized_split_index (const db::table <Key> * table, shard & separated, std::uint32_t timestamp) {
+    const auto index_filename = this->path (table, stream::index);
+    const auto tmp_index_filename = this->path (table, stream::index_log);
+    const auto separated_index_filename = separated.path (table, stream::index);
+    const auto separated_content_filename = separated.path (table, stream::content);
+
+    std::vector <slotted> lower;
+    std::vector <slotted> upper;
+
+    lower.reserve (this->cache.size ());
+    upper.reserve (this->cache.size ());
+
+    for (const auto & row : this->cache) {
+        if (row.id.timestamp >= timestamp) {
+            upper.push_back (row);
+        } else {
+            lower.push_back (row);
+        }
+    }
+
+    const auto n1 = upper.size ();
+    const auto n2 = lower.size ();
+
+    // rows keep their offsets into the content file, which becomes shared by both shards
+
+    if (!CreateHardLink (separated_content_filename.c_str (), this->path (table, stream::content).c_str (), NULL))
+        return false;
+
+    if (this->write_index (separated_index_filename, std::move (upper))
+            && this->write_index (tmp_index_filename, std::move (lower))) {
+
+        this->unsynchronized_close ();
+
+        if (MoveFileEx (tmp_index_filename.c_str (), index_filename.c_str (), MOVEFILE_REPLACE_EXISTING)) {
+            this->report (log::level::event, 13, this->base, timestamp, n1, n2, 0);
+            DeleteFile (this->path (table, stream::filter).c_str ());
+
+            this->unsynchronized_advance (table);
+            separated.unsynchronized_advance (table);
+            return true;
+        }
+        this->unsynchronized_advance (table);
+    }
+
+    DeleteFile (tmp_index_filename.c_str ());
+    DeleteFile (separated_index_filename.c_str ());
+    DeleteFile (separated_content_filename.c_str ());
+    return false;
+}
+
+template <typename Key>
+bool raddi::db::shard <Key>::write_index (const std::wstring & path, std::vector <slotted> rows) {
+
+    // keeping original order of rows in the index file
+
+    std::sort (rows.begin (), rows.end (),
+               [] (const slotted & a, const slotted & b) { return a.slot < b.slot; });
+
+    const std::vector <Key> data (rows.begin (), rows.end ());
+
+    file f;
+    if (f.create (path) && (data.empty () || f.write (data.data (), data.size () * sizeof (Key)))) {
+        f.flush ();
+        return true;
+    }
+
+    this->report (log::level::error, 14, path);
+    return false;
+}
+
+template <typename Key>
+raddi::db::shard <Key> raddi::db::shard <Key>::unsynchronized_split_copy (const db::table <Key> * table, std::uint32_t timestamp) {
     const auto tmp_index_filename = this->path (table, stream::index_log);
     const auto tmp_content_filename = this->path (table, stream::content_log);
 
@@ -517,7 +983,7 @@ raddi::db::shard <Key> raddi::db::shard <Key>::split (const db::table <Key> * ta
         && MoveFileEx (this->path (table, stream::index).c_str (), tmp_index_filename.c_str (), MOVEFILE_REPLACE_EXISTING)
         && MoveFileEx (this->path (table, stream::content).c_str (), tmp_content_filename.c_str (), MOVEFILE_REPLACE_EXISTING)) {
 
-        // TODO: this and remaining probably use the same data file
+        // fallback, copies all entries into new files
 
         shard remaining (this->base, table);
         shard separated (timestamp, table);
@@ -558,6 +1024,7 @@ raddi::db::shard <Key> raddi::db::shard <Key>::split (const db::table <Key> * ta
 
         DeleteFile (tmp_index_filename.c_str ());
         DeleteFile (tmp_content_filename.c_str ());
+        DeleteFile (this->path (table, stream::filter).c_str ());
 
         return std::move (separated);
     } else {
@@ -566,19 +1033,594 @@ raddi::db::shard <Key> raddi::db::shard <Key>::split (const db::table <Key> * ta
     }
 }
 
+template <typename Key>
+bool raddi::db::shard <Key>::prepare (const db::table <Key> * table, unsigned int threshold, compaction & c) {
+    exclusive guard (this->lock);
+
+    if (table->db.mode != file::access::write)
+        return false;
+
+    // content file size is compared first, shards unchanged since found not worth compacting aren't loaded again
+
+    const auto closed = this->index.closed ();
+    if (closed) {
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        if (!GetFileAttributesEx (this->path (table, stream::content).c_str (), GetFileExInfoStandard, &attributes))
+            return false;
+        if (((std::uintmax_t (attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow) == this->considered)
+            return false;
+    } else {
+        if (this->content.size () == this->considered)
+            return false;
+    }
+
+    // loading for compaction is not an access, shard stays first to be unloaded
+
+    const auto accessed = this->accessed;
+    if (!this->unsynchronized_advance (table))
+        return false;
+
+    this->accessed = accessed;
+
+    bool worth = false;
+    const auto used = this->unsynchronized_used ();
+    const auto size = this->content.size ();
+
+    if ((size != (std::uintmax_t) -1) && (size > used) && ((size - used) >= size / 100 * threshold)) {
+        try {
+            c.rows.assign (this->cache.begin (), this->cache.end ());
+            std::sort (c.rows.begin (), c.rows.end (),
+                       [] (const Key & a, const Key & b) { return a.data.offset < b.data.offset; });
+            c.size = size;
+            worth = true;
+        } catch (const std::bad_alloc &) {
+            this->report (log::level::error, 16, this->path (table));
+        }
+    } else {
+        this->considered = size;
+    }
+
+    if (closed) {
+        this->unsynchronized_unload (table);
+    }
+    return worth;
+}
+
+template <typename Key>
+bool raddi::db::shard <Key>::copy (const db::table <Key> * table, compaction & c) const {
+    const auto content_filename = this->path (table, stream::content);
+    const auto copy_filename = this->path (table, stream::content_copy);
+
+    // content file is opened separately, it's only appended to while this copies
+    //  - rows erased meanwhile are copied too, those are left out when committing
+
+    file source;
+    if (!source.open (content_filename, file::mode::open, file::access::read, file::share::full, file::buffer::sequential)) {
+        this->report (log::level::error, 12, content_filename, file::access::read, file::share::full);
+        return false;
+    }
+
+    bool success = false;
+    file content;
+    if (content.create (copy_filename, file::buffer::sequential)) {
+        try {
+            std::vector <std::uint8_t> buffer;
+            std::uintmax_t offset = 0;
+
+            static constexpr std::size_t chunk = 1024 * 1024;
+            buffer.reserve (chunk + sizeof (raddi::entry) + raddi::entry::max_content_size);
+
+            c.offsets.clear ();
+            c.offsets.reserve (c.rows.size ());
+
+            success = true;
+            for (const auto & row : c.rows) {
+                const auto length = std::size_t (row.data.length + sizeof (raddi::entry::signature));
+                const auto at = buffer.size ();
+
+                buffer.resize (at + length);
+                if (!source.read (row.data.offset, &buffer [at], length)) {
+                    this->report (log::level::error, 17, row.data.offset, length);
+                    success = false;
+                    break;
+                }
+
+                table->db.xor_mask (&buffer [at], &buffer [at], length, row.data.offset);
+                table->db.xor_mask (&buffer [at], &buffer [at], length, offset + at);
+                c.offsets.push_back (offset + at);
+
+                if (buffer.size () >= chunk) {
+                    if (!content.write (buffer.data (), buffer.size ())) {
+                        this->report (log::level::error, 15, copy_filename);
+                        success = false;
+                        break;
+                    }
+                    offset += buffer.size ();
+                    buffer.clear ();
+                }
+            }
+
+            if (success && !buffer.empty ()) {
+                if (content.write (buffer.data (), buffer.size ())) {
+                    offset += buffer.size ();
+                } else {
+                    this->report (log::level::error, 15, copy_filename);
+                    success = false;
+                }
+            }
+            c.copied = offset;
+
+        } catch (const std::bad_alloc &) {
+            this->report (log::level::error, 16, this->path (table));
+            success = false;
+        }
+        content.close ();
+    } else {
+        this->report (log::level::error, 12, copy_filename, file::access::write, file::share::none);
+    }
+
+    if (!success) {
+        DeleteFile (copy_filename.c_str ());
+    }
+    return success;
+}
+
+template <typename Key>
+bool raddi::db::shard <Key>::commit (const db::table <Key> * table, const compaction & c) {
+    exclusive guard (this->lock);
+
+    if (table->db.mode != file::access::write)
+        return false;
+
+    const auto closed = this->index.closed ();
+    const auto accessed = this->accessed;
+    if (!this->unsynchronized_advance (table))
+        return false;
+
+    this->accessed = accessed;
+
+    const auto copy_filename = this->path (table, stream::content_copy);
+    const auto size = this->content.size ();
+
+    // content file smaller than when prepared was rewritten meanwhile
+
+    bool success = (size != (std::uintmax_t) -1) && (size >= c.size);
+
+    std::vector <slotted> rows;
+    std::uintmax_t offset = c.copied;
+
+    if (success) {
+        try {
+            rows.assign (this->cache.begin (), this->cache.end ());
+
+            file content;
+            std::vector <std::uint8_t> buffer;
+
+            for (auto & row : rows) {
+                const auto length = std::size_t (row.data.length + sizeof (raddi::entry::signature));
+
+                if (row.data.offset < c.size) {
+
+                    // copied, unless the row was moved by rewrite since 'prepare'
+
+                    const auto i = std::lower_bound (c.rows.begin (), c.rows.end (), row.data.offset,
+                                                     [] (const Key & r, std::uintmax_t position) { return r.data.offset < position; });
+                    if ((i != c.rows.end ()) && (i->data.offset == row.data.offset)
+                            && (i->data.length == row.data.length) && (i->id == row.id)) {
+
+                        row.data.offset = c.offsets [i - c.rows.begin ()];
+                    } else {
+                        success = false;
+                        break;
+                    }
+                } else {
+
+                    // appended since 'prepare', copied now
+
+                    if (content.closed ()) {
+                        if (!content.open (copy_filename, file::mode::open, file::access::write, file::share::none)
+                                || (content.seek (offset) != offset)) {
+                            this->report (log::level::error, 12, copy_filename, file::access::write, file::share::none);
+                            success = false;
+                            break;
+                        }
+                    }
+
+                    buffer.resize (length);
+                    if (!this->unsynchronized_read_content (table, row.data.offset, buffer.data (), length)) {
+                        this->report (log::level::error, 17, row.data.offset, length);
+                        success = false;
+                        break;
+                    }
+
+                    table->db.xor_mask (buffer.data (), buffer.data (), length, row.data.offset);
+                    table->db.xor_mask (buffer.data (), buffer.data (), length, offset);
+
+                    if (!content.write (buffer.data (), length)) {
+                        this->report (log::level::error, 15, copy_filename);
+                        success = false;
+                        break;
+                    }
+                    row.data.offset = offset;
+                    offset += length;
+                }
+            }
+            if (success && !content.closed ()) {
+                content.flush ();
+            }
+        } catch (const std::bad_alloc &) {
+            this->report (log::level::error, 16, this->path (table));
+            success = false;
+        }
+    }
+
+    // copy becomes the content file of regular rewrite, see 'unsynchronized_rewrite'
+
+    if (success) {
+        if (MoveFileEx (copy_filename.c_str (), this->path (table, stream::content_log).c_str (),
+                        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+
+            if (this->unsynchronized_commit (table, rows, offset, size)) {
+                this->considered = offset;
+                if (closed) {
+                    this->unsynchronized_unload (table);
+                }
+                return true;
+            } else
+                return false;
+        } else {
+            this->report (log::level::error, 27);
+        }
+    }
+
+    DeleteFile (copy_filename.c_str ());
+    if (closed) {
+        this->unsynchronized_unload (table);
+    }
+    return false;
+}
+
+template <typename Key>
+    template <typename F>
+std::size_t raddi::db::shard <Key>::retire (const db::table <Key> * table, F keep) {
+    exclusive guard (this->lock);
+
+    if (table->db.mode != file::access::write)
+        return (std::size_t) -1;
+    if (!this->unsynchronized_advance (table))
+        return (std::size_t) -1;
+
+    std::vector <slotted> kept;
+    try {
+        kept.reserve (this->cache.size ());
+        for (const auto & row : this->cache) {
+            if (keep (row.id, row.top ())) {
+                kept.push_back (row);
+            }
+        }
+    } catch (const std::bad_alloc &) {
+        this->report (log::level::error, 16, this->path (table));
+        return (std::size_t) -1;
+    }
+
+    const auto n = kept.size ();
+    if (n == this->cache.size ())
+        return n;
+
+    if (n == 0) {
+
+        // index first, readers then drop the shard before the content disappears
+
+        this->unsynchronized_close ();
+        if (DeleteFile (this->path (table, stream::index).c_str ())) {
+            DeleteFile (this->path (table, stream::content).c_str ());
+            DeleteFile (this->path (table, stream::filter).c_str ());
+            this->filter.clear ();
+            this->report (log::level::event, 16, this->base, 0);
+            return 0;
+        } else {
+            this->report (log::level::error, 29, this->path (table, stream::index));
+            this->unsynchronized_advance (table);
+            return (std::size_t) -1;
+        }
+    }
+
+    // rows are dropped from cache first, rewrite then persists only those kept
+    //  - on failure the shard is reloaded from unchanged files
+
+    const auto size = this->content.size ();
+    this->cache.assign (std::move (kept));
+    this->unsynchronized_rebuild_secondary ();
+
+    if (this->unsynchronized_rewrite (table, this->unsynchronized_used (), size)) {
+        this->report (log::level::event, 16, this->base, n);
+        return n;
+    } else {
+        this->unsynchronized_close ();
+        this->unsynchronized_advance (table);
+        return (std::size_t) -1;
+    }
+}
+
+template <typename Key>
+std::uintmax_t raddi::db::shard <Key>::unsynchronized_used () const {
+    std::uintmax_t used = 0;
+    for (const auto & row : this->cache) {
+        used += row.data.length + sizeof (raddi::entry::signature);
+    }
+    return used;
+}
+
+template <typename Key>
+bool raddi::db::shard <Key>::unsynchronized_rewrite (const db::table <Key> * table, std::uintmax_t used, std::uintmax_t size) {
+    const auto tmp_content_filename = this->path (table, stream::content_log);
+
+    bool success = false;
+    std::vector <slotted> rows;
+    try {
+        rows.assign (this->cache.begin (), this->cache.end ());
+        std::vector <std::uint8_t> buffer;
+        std::uintmax_t offset = 0;
+
+        static constexpr std::size_t chunk = 1024 * 1024;
+        buffer.reserve (chunk + sizeof (raddi::entry) + raddi::entry::max_content_size);
+
+        file content;
+        if (content.create (tmp_content_filename, file::buffer::sequential)) {
+            success = true;
+
+            // content is rewritten in original order of rows in the index file
+            //  - data are unmasked and masked again for new position
+
+            std::sort (rows.begin (), rows.end (),
+                       [] (const slotted & a, const slotted & b) { return a.slot < b.slot; });
+
+            for (auto & row : rows) {
+                const auto length = std::size_t (row.data.length + sizeof (raddi::entry::signature));
+                const auto at = buffer.size ();
+
+                buffer.resize (at + length);
+                if (!this->unsynchronized_read_content (table, row.data.offset, &buffer [at], length)) {
+                    this->report (log::level::error, 17, row.data.offset, length);
+                    success = false;
+                    break;
+                }
+
+                table->db.xor_mask (&buffer [at], &buffer [at], length, row.data.offset);
+                table->db.xor_mask (&buffer [at], &buffer [at], length, offset + at);
+                row.data.offset = offset + at;
+
+                if (buffer.size () >= chunk) {
+                    if (!content.write (buffer.data (), buffer.size ())) {
+                        this->report (log::level::error, 15, tmp_content_filename);
+                        success = false;
+                        break;
+                    }
+                    offset += buffer.size ();
+                    buffer.clear ();
+                }
+            }
+
+            if (success && !buffer.empty () && !content.write (buffer.data (), buffer.size ())) {
+                this->report (log::level::error, 15, tmp_content_filename);
+                success = false;
+            }
+            if (success) {
+                content.flush ();
+            }
+        } else {
+            this->report (log::level::error, 12, tmp_content_filename, file::access::write, file::share::none);
+        }
+    } catch (const std::bad_alloc &) {
+        this->report (log::level::error, 16, this->path (table));
+        success = false;
+    }
+
+    if (success)
+        return this->unsynchronized_commit (table, rows, used, size);
+
+    DeleteFile (tmp_content_filename.c_str ());
+    return false;
+}
+
+template <typename Key>
+bool raddi::db::shard <Key>::unsynchronized_commit (const db::table <Key> * table, std::vector <slotted> & rows,
+                                                    std::uintmax_t used, std::uintmax_t size) {
+    const auto tmp_index_filename = this->path (table, stream::index_log);
+    const auto tmp_content_filename = this->path (table, stream::content_log);
+
+    bool success = false;
+    try {
+        success = this->write_index (tmp_index_filename, std::move (rows));
+    } catch (const std::bad_alloc &) {
+        this->report (log::level::error, 16, this->path (table));
+    }
+
+    if (success) {
+        this->unsynchronized_close ();
+
+        // both temporary files are complete on disk, renaming the index to 'index_commit' commits the rewrite
+        //  - 'unsynchronized_recover' then moves content and index into place, index last,
+        //    and if interrupted (failure or crash), it's finished when the shard is opened next time
+
+        if (MoveFileEx (tmp_index_filename.c_str (), this->path (table, stream::index_commit).c_str (),
+                        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+
+            DeleteFile (this->path (table, stream::filter).c_str ());
+            if (this->unsynchronized_recover (table)) {
+                this->report (log::level::event, 14, this->base, size - used, size);
+                this->unsynchronized_advance (table);
+                return true;
+            } else
+                return false; // shard stays closed, opening it retries
+        }
+        this->report (log::level::error, 27);
+        this->unsynchronized_advance (table);
+    }
+
+    DeleteFile (tmp_index_filename.c_str ());
+    DeleteFile (tmp_content_filename.c_str ());
+    return false;
+}
+
+template <typename Key>
+bool raddi::db::shard <Key>::unsynchronized_recover (const db::table <Key> * table) {
+    const auto commit_filename = this->path (table, stream::index_commit);
+
+    if (GetFileAttributes (commit_filename.c_str ()) == INVALID_FILE_ATTRIBUTES) {
+        switch (GetLastError ()) {
+            case ERROR_FILE_NOT_FOUND:
+            case ERROR_PATH_NOT_FOUND:
+                return true; // no rewrite in progress
+        }
+    }
+
+    // only writer finishes the rewrite, readers wait until it's done (index is replaced)
+
+    if (table->db.mode != file::access::write)
+        return false;
+
+    // content may have already been moved
+
+    if (MoveFileEx (this->path (table, stream::content_log).c_str (), this->path (table, stream::content).c_str (),
+                    MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)
+            || (GetLastError () == ERROR_FILE_NOT_FOUND)) {
+
+        if (MoveFileEx (commit_filename.c_str (), this->path (table, stream::index).c_str (),
+                        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+            return true;
+    }
+
+    this->report (log::level::error, 27);
+    return false;
+}
+
+template <typename Key>
+bool raddi::db::shard <Key>::list (const db::table <Key> * table, std::vector <Key> & rows) {
+    exclusive guard (this->lock);
+
+    if (!this->unsynchronized_advance (table))
+        return false;
+
+    const auto index_size = this->index.size ();
+    if ((index_size != (std::uintmax_t) -1) && (index_size % sizeof (Key))) {
+        this->report (log::level::error, 34, this->path (table), index_size, sizeof (Key));
+    }
+
+    rows.assign (this->cache.begin (), this->cache.end ());
+    return true;
+}
+
+template <typename Key>
+bool raddi::db::shard <Key>::inspect (const db::table <Key> * table, const decltype (Key::id) & id,
+                                      Key * row, void * buffer, const wchar_t ** failure) {
+    exclusive guard (this->lock);
+
+    // shard might have been unloaded, or rewritten (row moved), since 'list'
+
+    if (!this->unsynchronized_advance (table)) {
+        *failure = L"unreadable";
+        return true;
+    }
+
+    if (auto ii = this->cache.find ({ Key { id } })) {
+        const auto size = this->content.size ();
+
+        *row = *ii;
+        *failure = nullptr;
+
+        if ((size == (std::uintmax_t) -1) || (ii->data.offset + ii->data.length + sizeof (raddi::entry::signature) > size)) {
+            *failure = L"outside of content file";
+        } else
+        if (!this->unsynchronized_read (table, *ii, read::everything, buffer)) {
+            *failure = L"unreadable";
+        }
+        return true;
+    } else
+        return false;
+}
+
+template <typename Key>
+std::size_t raddi::db::shard <Key>::repair (const db::table <Key> * table, const std::vector <decltype (Key::id)> & ids) {
+    exclusive guard (this->lock);
+
+    if ((table->db.mode != file::access::write) || !this->unsynchronized_advance (table))
+        return 0;
+
+    std::size_t n = 0;
+    for (const auto & id : ids) {
+        if (auto ii = this->cache.find ({ Key { id } })) {
+            const auto offset = std::uintmax_t (ii->slot) * sizeof (Key);
+            if (this->index.zero (offset, sizeof (Key))) {
+                ++n;
+            } else {
+                this->report (log::level::error, 20, this->path (table), offset, sizeof (Key));
+            }
+        }
+    }
+
+    // everything in memory is rebuilt from the repaired index file
+
+    if (n) {
+        this->considered = 0;
+        this->unsynchronized_close ();
+        this->filter.clear ();
+        this->unsynchronized_advance (table);
+    }
+    return n;
+}
+
 template <typename Key>
     template <typename F>
 void raddi::db::shard <Key> ::enumerate (const db::table <Key> * table, F callback) {
     immutability guard (this->lock);
 
-    auto i = this->cache.cbegin ();
-    auto e = this->cache.cend ();
+    for (const auto & row : this->cache) {
+        if (callback (row, nullptr)) {
+            std::uint8_t data [raddi::protocol::max_payload];
+            if (this->unsynchronized_read (table, row, read::everything, data)) {
+                callback (row, data);
+            }
+        }
+    }
+    this->accessed = raddi::now ();
+}
+
+template <typename Key>
+    template <typename F>
+void raddi::db::shard <Key> ::enumerate (const db::table <Key> * table,
+                                         std::initializer_list <db::secondary> indexes, const eid & key, F callback) {
+    immutability guard (this->lock);
 
-    for (; i != e; ++i) {
-        if (callback (*i, nullptr)) {
+    const auto process = [this, table, &callback] (const Key & row) {
+        if (callback (row, nullptr)) {
             std::uint8_t data [raddi::protocol::max_payload];
-            if (this->unsynchronized_read (table, i, read::everything, data)) {
-                callback (*i, data);
+            if (this->unsynchronized_read (table, row, read::everything, data)) {
+                callback (row, data);
+            }
+        }
+    };
+
+    if constexpr (Key::indexed) {
+        for (auto s : indexes) {
+            const auto & index = this->secondary [(unsigned int) s];
+
+            auto ix = index.lower_bound ({ key, decltype (Key::id) {} });
+            auto ex = index.end ();
+
+            for (; (ix != ex) && (ix->first == key); ++ix) {
+                if (auto ii = this->cache.find ({ Key { ix->second } })) {
+                    process (*ii);
+                }
+            }
+        }
+    } else {
+        for (const auto & row : this->cache) {
+            for (auto s : indexes) {
+                if (row.secondary (s) == key) {
+                    process (row);
+                    break;
+                }
             }
         }
     }
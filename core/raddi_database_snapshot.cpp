@@ -0,0 +1,364 @@
+#include <windows.h>
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include "raddi_database.h"
+#include "raddi_database_row.h"
+#include "raddi_database_shard.h"
+#include "raddi_database_table.h"
+
+#include "raddi_identity.h"
+#include "raddi_timestamp.h"
+
+#include "../common/file.h"
+
+#include <lzma.h>
+
+// snapshot file format
+//  - header, followed by chunks until end of file
+//  - chunk contains entries of single table, sorted by id, with timestamps in 'oldest'..'latest' range
+//  - chunk payload is sequence of records: root, entry size (16-bit), entry as transmitted (unmasked)
+//  - identities come first, then channels, then data; threads are derived from root on import
+//     - root is only checked on import, it's derived from the parent the same way 'assess' does
+//  - all values are little-endian, as written by x86/ARM Windows
+//
+namespace {
+    static constexpr char snapshot_magic [8] = { 'R', 'A', 'D', 'D', 'I', 'S', 'N', 'P' };
+    static constexpr std::uint32_t snapshot_version = 1;
+
+    // chunk limits
+    //  - chunk is closed after this many entries or payload bytes
+    //
+    static constexpr std::uint32_t chunk_entries = 4096;
+    static constexpr std::uint32_t chunk_bytes = 4 * 1024 * 1024;
+
+    struct snapshot_header {
+        char          magic [8];
+        std::uint32_t version;
+        std::uint32_t reserved;
+    };
+
+    struct chunk_header {
+        std::uint32_t table;
+        std::uint32_t oldest;
+        std::uint32_t latest;
+        std::uint32_t count;
+        std::uint64_t bytes;
+        std::uint64_t crc; // CRC-64 of payload, courtesy of lzma library
+    };
+
+    struct record_header {
+        raddi::db::root top;
+        std::uint16_t   size;
+    };
+
+    // chunk
+    //  - accumulates records of single chunk being exported
+    //
+    class chunk {
+        file &                      f;
+        chunk_header                header;
+        std::vector <std::uint8_t>  payload;
+
+    public:
+        std::size_t chunks = 0;
+        std::size_t entries = 0;
+        bool        failed = false;
+
+        explicit chunk (file & f) : f (f) {
+            this->payload.reserve (chunk_bytes + sizeof (record_header) + raddi::protocol::max_payload);
+            this->header.count = 0;
+        }
+
+        void add (std::uint32_t table, const raddi::db::root & top, const std::uint8_t * data, std::size_t size) {
+            const auto timestamp = reinterpret_cast <const raddi::entry *> (data)->id.timestamp;
+
+            if (this->header.count && (this->header.table != table)) {
+                this->flush ();
+            }
+            if (this->header.count == 0) {
+                this->header.table = table;
+                this->header.oldest = timestamp;
+                this->header.latest = timestamp;
+            }
+
+            record_header record;
+            record.top = top;
+            record.size = (std::uint16_t) size;
+
+            const auto at = this->payload.size ();
+            this->payload.resize (at + sizeof record + size);
+            std::memcpy (&this->payload [at], &record, sizeof record);
+            std::memcpy (&this->payload [at + sizeof record], data, size);
+
+            this->header.oldest = std::min (this->header.oldest, timestamp);
+            this->header.latest = std::max (this->header.latest, timestamp);
+
+            if ((++this->header.count >= chunk_entries) || (this->payload.size () >= chunk_bytes)) {
+                this->flush ();
+            }
+        }
+
+        void flush () {
+            if (this->header.count && !this->failed) {
+                this->header.bytes = this->payload.size ();
+                this->header.crc = lzma_crc64 (this->payload.data (), this->payload.size (), 0);
+
+                if (this->f.write (this->header) && this->f.write (this->payload.data (), this->payload.size ())) {
+                    this->entries += this->header.count;
+                    this->chunks += 1;
+                } else {
+                    this->failed = true;
+                }
+            }
+            this->header.count = 0;
+            this->payload.clear ();
+        }
+    };
+}
+
+std::size_t raddi::db::export_snapshot (const std::wstring & path, std::uint32_t oldest, std::uint32_t latest) const {
+    file f;
+    if (!f.create (path, file::buffer::sequential)) {
+        this->report (log::level::error, 30, path);
+        return (std::size_t) -1;
+    }
+
+    snapshot_header header;
+    std::memcpy (header.magic, snapshot_magic, sizeof header.magic);
+    header.version = snapshot_version;
+    header.reserved = 0;
+
+    if (!f.write (header)) {
+        this->report (log::level::error, 30, path);
+        return (std::size_t) -1;
+    }
+
+    try {
+        chunk output (f);
+
+        // announcement tables first, importer verifies everything else against them
+        //  - data table includes thread entries, 'threads' table is rebuilt from their root
+
+        const auto exporter = [&output] (std::uint32_t table) {
+            return [&output, table] (const auto & row, const auto &, std::uint8_t * data) {
+                output.add (table, row.top (), data, row.data.length + sizeof (raddi::entry));
+            };
+        };
+
+        this->identities->select (oldest, latest, exporter (0));
+        this->channels->select (oldest, latest, exporter (1));
+        this->data->select (oldest, latest, exporter (2));
+
+        output.flush ();
+
+        if (output.failed) {
+            this->report (log::level::error, 30, path);
+            return (std::size_t) -1;
+        }
+
+        this->report (log::level::event, 17, path, output.entries, output.chunks);
+        return output.entries;
+
+    } catch (const std::bad_alloc &) {
+        this->report (log::level::error, 33, path);
+        return (std::size_t) -1;
+    }
+}
+
+std::size_t raddi::db::import_snapshot (const std::wstring & path) {
+    file f;
+    if (!f.open (path, file::mode::open, file::access::read, file::share::read, file::buffer::sequential)) {
+        this->report (log::level::error, 32, path);
+        return 0;
+    }
+
+    snapshot_header header;
+    if (!f.read (header)
+            || std::memcmp (header.magic, snapshot_magic, sizeof header.magic)
+            || (header.version != snapshot_version)) {
+
+        this->report (log::level::error, 31, path, 0);
+        return 0;
+    }
+
+    std::size_t inserted = 0;
+    std::size_t existing = 0;
+    std::size_t rejected = 0;
+
+    try {
+        std::vector <std::uint8_t> payload;
+        std::vector <insertion> items;
+        std::vector <char> valid;
+
+        chunk_header block;
+        while (f.read (block)) {
+            const auto offset = f.tell () - sizeof block;
+
+            // chunk is verified as whole before anything from it is inserted
+
+            if ((block.table > 2) || (block.bytes > chunk_bytes + sizeof (record_header) + raddi::protocol::max_payload)) {
+                this->report (log::level::error, 31, path, offset);
+                break;
+            }
+
+            payload.resize ((std::size_t) block.bytes);
+            if (!f.read (payload.data (), payload.size ())
+                    || (lzma_crc64 (payload.data (), payload.size (), 0) != block.crc)) {
+                this->report (log::level::error, 31, path, offset);
+                break;
+            }
+
+            items.clear ();
+            items.reserve (block.count);
+
+            std::size_t position = 0;
+            while (position + sizeof (record_header) <= payload.size ()) {
+                record_header record;
+                std::memcpy (&record, &payload [position], sizeof record);
+                position += sizeof record;
+
+                if ((record.size < sizeof (raddi::entry)) || (position + record.size > payload.size ()))
+                    break;
+
+                insertion item;
+                item.entry = reinterpret_cast <const raddi::entry *> (&payload [position]);
+                item.size = record.size;
+                item.top = record.top;
+                items.push_back (item);
+
+                position += record.size;
+            }
+
+            if ((position != payload.size ()) || (items.size () != block.count)) {
+                this->report (log::level::error, 31, path, offset);
+                break;
+            }
+
+            // signatures are verified in parallel
+            //  - authors of entries in channels/data chunks are already in the database,
+            //    identities chunks are self-signed
+
+            valid.assign (items.size (), 0);
+
+            const auto verify = [this, &items, &valid] (std::size_t begin, std::size_t end) {
+                struct : public raddi::identity {
+                    std::uint8_t description [raddi::identity::max_description_size];
+                } author;
+
+                for (auto i = begin; i != end; ++i) {
+                    const auto entry = items [i].entry;
+                    const auto size = items [i].size;
+
+                    if (raddi::entry::validate (entry, size)) {
+                        switch (entry->is_announcement ()) {
+                            case raddi::entry::new_identity_announcement:
+                                valid [i] = static_cast <const raddi::identity *> (entry)->verify (size);
+                                break;
+                            case raddi::entry::new_channel_announcement:
+                            case raddi::entry::not_an_announcement:
+                                valid [i] = this->identities->get (entry->id.identity, read::content, &author, nullptr, sizeof (identity::public_key))
+                                         && entry->verify (size, author.public_key);
+                                break;
+                        }
+                    }
+                }
+                return false;
+            };
+
+            const auto n = items.size ();
+            const auto concurrency = std::max <std::size_t> (1, std::min <std::size_t> (this->settings.warm_up_threads, n / 64));
+
+            if (concurrency > 1) {
+                batch work;
+                for (std::size_t k = 0; k != concurrency; ++k) {
+                    work.jobs.push_back ([verify, n, k, concurrency] {
+                        return verify (n * k / concurrency, n * (k + 1) / concurrency);
+                    });
+                }
+                work.start (concurrency);
+                work.wait ();
+            } else {
+                verify (0, n);
+            }
+
+            // root of entries is derived from parent, same as in 'assess', and must match the stored one
+            //  - parent is either already in the database (previous chunks included)
+            //    or it's earlier valid record of this chunk, records are sorted by id
+
+            std::unordered_map <eid, root, eid::hash> roots;
+
+            const auto derive = [this, &roots] (const raddi::entry * entry, root & top) {
+                if (this->channels->get (entry->parent)
+                        || ((entry->parent.timestamp == entry->parent.identity.timestamp) && this->identities->get (entry->parent.identity))) {
+
+                    top.channel = entry->parent;
+                    top.thread = entry->id;
+                    return true;
+                }
+
+                const auto local = roots.find (entry->parent);
+                if (local != roots.end ()) {
+                    top = local->second;
+                    return true;
+                }
+
+                trow tr;
+                if (this->threads->get (entry->parent, &tr)) {
+                    top.channel = tr.parent;
+                    top.thread = entry->parent;
+                    return true;
+                }
+
+                row r;
+                if (this->data->get (entry->parent, &r)) {
+                    top = r.top ();
+                    return true;
+                }
+                return false;
+            };
+
+            for (std::size_t i = 0; i != n; ++i) {
+                const auto entry = items [i].entry;
+                if (valid [i] && (entry->is_announcement () == raddi::entry::not_an_announcement)) {
+
+                    root top;
+                    if (derive (entry, top) && (top.channel == items [i].top.channel) && (top.thread == items [i].top.thread)) {
+                        roots.emplace (entry->id, top);
+                    } else {
+                        valid [i] = false;
+                    }
+                }
+            }
+
+            // verified entries are bulk-inserted, bypassing 'assess'
+
+            std::size_t m = 0;
+            for (std::size_t i = 0; i != n; ++i) {
+                if (valid [i]) {
+                    items [m++] = items [i];
+                } else {
+                    this->report (log::level::data, 9, items [i].entry->id.serialize ());
+                    ++rejected;
+                }
+            }
+
+            this->insert (items.data (), m);
+            for (std::size_t i = 0; i != m; ++i) {
+                if (items [i].exists) {
+                    ++existing;
+                } else
+                if (items [i].inserted) {
+                    ++inserted;
+                }
+            }
+        }
+    } catch (const std::bad_alloc &) {
+        this->report (log::level::error, 33, path);
+    }
+
+    this->report (log::level::event, 18, path, inserted, existing, rejected);
+    return inserted;
+}
@@ -3,6 +3,7 @@
 
 #include "raddi_database.h"
 #include "raddi_database_row.h"
+#include "raddi_database_journal.h"
 #include <set>
 #include <map>
 
@@ -10,7 +11,7 @@
 //  - database table, set of shards
 //  - NOTE: shards storage (shard.base) is not ready for timestamp wrap-around
 //  - performance consideration: 64 posts and 320 votes per second ...top rate is new file per 1 minute
-//  - TODO: Monitor::process is not implemented yet!!!
+//  - readers follow writer's changes through Monitor, see 'process'
 //
 template <typename Key>
 class raddi::db::table
@@ -23,6 +24,25 @@ class raddi::db::table
     mutable ::lock                   advance_lock;
     mutable std::set <std::uint32_t> advance_marks;
 
+    // counts
+    //  - Fenwick (binary indexed) tree over row counts of 'shards' for positional 'get' and 'count'
+    //  - 'sizes' are shard sizes as currently accounted in the tree, parallel to 'shards'
+    //  - updated after every insert, erase and advance of a shard; rebuilt, lazily,
+    //    after shards are added, split or reloaded
+    //  - protected by 'counts_lock', always acquired after 'lock'
+    //
+    mutable ::lock                       counts_lock;
+    mutable std::vector <std::uint64_t>  counts;
+    mutable std::vector <std::size_t>    sizes;
+    mutable std::uint64_t                total = 0;
+    mutable bool                         counted = false;
+
+    // wal
+    //  - write-ahead journal of appends to shard files, see 'journal'
+    //  - writer checkpoints it after flushing shards, replays it in 'reload'
+    //
+    mutable db::journal wal;
+
 public:
     const raddi::db &  db;
     const std::wstring name;
@@ -42,9 +62,15 @@ public:
     table (const std::wstring & name, const raddi::db & db)
         : Monitor (db.path + L"\\" + name + L"\\")
         , provider ("table", name)
+        , wal (db.table_directory_path (name) + L"journal")
         , db (db)
         , name (name) {}
 
+    // table destructor
+    //  - closes all shards, so that writer persists their Bloom filters
+    //
+    ~table ();
+
     // start
     //  - used by 'reading' database connection to monitor for table changes
     //
@@ -52,14 +78,72 @@ public:
 
     // reload
     //  - attempts to reload index of shards from directory contents
+    //  - writer first replays journal left by previous run, see 'journal'
     //
     bool reload ();
 
+    // unloaded
+    //  - returns bases of up to 'n' newest shards that are not loaded, newest first
+    //
+    std::vector <std::uint32_t> unloaded (std::size_t n) const;
+
+    // warm
+    //  - loads shard 'base' if it's still in the table and not loaded yet
+    //  - returns true if the shard was loaded
+    //
+    bool warm (std::uint32_t base) const;
+
+    // expired
+    //  - returns bases of shards containing only entries older than 'threshold'
+    //  - the newest shard is never considered expired
+    //
+    std::vector <std::uint32_t> expired (std::uint32_t threshold) const;
+
+    // retire
+    //  - retires expired shard 'base', see shard::retire, removing it if nothing is kept
+    //  - returns true if the shard was changed or removed
+    //
+    template <typename F>
+    bool retire (std::uint32_t base, std::uint32_t threshold, F keep);
+
+    // inactive
+    //  - returns bases of shards, loaded or not, not accessed since 'threshold'
+    //
+    std::vector <std::uint32_t> inactive (std::uint32_t threshold) const;
+
+    // compact
+    //  - compacts shard 'base' if at least 'threshold' percent of its content file is not referenced,
+    //    see shard::compaction; closed shard is loaded only for the time needed
+    //  - content is copied with no table lock held, exclusive lock is taken only to write
+    //    new index and replace the files
+    //  - returns true if the shard was compacted
+    //
+    bool compact (std::uint32_t base, unsigned int threshold);
+
+    // verify
+    //  - checks that every row of shard 'base' points into content file and passes 'check' with its full entry
+    //  - callback signature must be compatible with: const wchar_t * f (const Key &, const raddi::entry *, std::size_t);
+    //     - returns nullptr if the entry is valid, otherwise short description of the failure
+    //     - called without any lock held, it may look up other entries, in this table too
+    //  - if 'repair' then failed rows are erased and shard reloaded, table is locked exclusively meanwhile
+    //  - 'rows' and 'repaired' receive number of rows checked and erased
+    //  - returns number of rows that failed, or -1 if the shard cannot be loaded
+    //
+    template <typename F>
+    std::size_t verify (std::uint32_t base, F check, bool repair, std::size_t * rows, std::size_t * repaired);
+
     // flush
     //  - general flush of data and metadata so that db readers see the changes
+    //  - then empties the journal, flushed data are no longer needed there
     //
     void flush ();
 
+    // write_ahead
+    //  - journals append to shard files, called by shard before the files are written
+    //  - returns true also when journal is disabled, see 'write_ahead_journal'
+    //
+    bool write_ahead (const journal::record &, const void * rows, const void * content) const;
+
     // prune/optimize
     //  - frees memory and closes oldest shards
     //     - prune closes shards exceeding the 'keep' count
@@ -69,6 +153,19 @@ public:
     std::size_t prune (std::size_t keep);
     std::size_t optimize (std::uint32_t threshold);
 
+    // usage
+    //  - appends last access time, base and memory footprint of every loaded shard into 'list',
+    //    tagged with 'id' of the table
+    //  - returns total bytes used by loaded shards of the table
+    //
+    std::size_t usage (std::vector <db::usage> & list, unsigned int id) const;
+
+    // evict
+    //  - closes shard 'base' unless it was accessed after 'accessed', i.e. since 'usage'
+    //  - returns true if the shard was closed
+    //
+    bool evict (std::uint32_t base, std::uint32_t accessed);
+
     // insert
     //  - inserts whole entry (decoded protocol frame) into the table, copying parent thread
     //  - if parent entry is missing from the table the insertion fails
@@ -76,6 +173,12 @@ public:
     //
     bool insert (const entry * entry, std::size_t size, const root &, bool & exists);
 
+    // insert (batch)
+    //  - inserts entries grouped by destination shard, see db::insert (insertion *, n)
+    //  - 'items' are reordered (sorted by timestamp)
+    //
+    std::size_t insert (std::vector <insertion *> & items);
+
     // erase
     //  - erases specified entry from the table
     //  - if 'thorough' then also content is overwritten by zeros
@@ -159,8 +262,52 @@ public:
     //
     template <typename T, typename U, typename V>
     std::size_t select (std::uint32_t oldest, std::uint32_t latest,
+                        T constrain, U query, V callback) const {
+        return this->select (summary_query {}, oldest, latest, constrain, query, callback);
+    }
+
+    // select
+    //  - same as above, but evaluates only rows that have 'key' in any of the secondary 'indexes'
+    //    thus skipping most of the rows when looking for entries of a single channel/thread/author
+    //  - the 'index' member of unnamed structure is then position within the matching rows
+    //  - typical use: { secondary::channel, secondary::thread }, eid - all entries within channel or thread
+    //
+    template <typename T, typename U, typename V>
+    std::size_t select (std::initializer_list <db::secondary> indexes, const eid & key,
+                        std::uint32_t oldest, std::uint32_t latest,
+                        T constrain, U query, V callback) const {
+        return this->select (summary_query {}, indexes, key, oldest, latest, constrain, query, callback);
+    }
+
+    // select
+    //  - same as the two above, but evaluates only rows whose content summary matches 'filter'
+    //    (before 'constrain' is called and before 'match' is counted), see 'summary_query'
+    //  - shards whose aggregated summaries rule out any match are skipped without being loaded
+    //  - rows of tables without content summary (not Key::summarized) match only empty 'filter'
+    //  - typical use: moderation or votes of a channel, without decoding the whole history
+    //
+    template <typename T, typename U, typename V>
+    std::size_t select (const summary_query & filter, std::uint32_t oldest, std::uint32_t latest,
+                        T constrain, U query, V callback) const;
+
+    template <typename T, typename U, typename V>
+    std::size_t select (const summary_query & filter,
+                        std::initializer_list <db::secondary> indexes, const eid & key,
+                        std::uint32_t oldest, std::uint32_t latest,
                         T constrain, U query, V callback) const;
 
+    // count
+    //  - calls select to count number of entries matching 'filter' within the range
+    //
+    std::size_t count (const summary_query & filter,
+                       std::initializer_list <db::secondary> indexes, const eid & key,
+                       std::uint32_t oldest, std::uint32_t latest) const {
+        return this->select (filter, indexes, key, oldest, latest,
+                             [] (const Key &, const auto & detail) { return true; },
+                             [] (const Key &, const auto & detail) { return false; },
+                             [] (const Key &, const auto & detail, std::uint8_t *) {});
+    }
+
     // select
     //  - calls 'callback' with full entry data for every entry in range
     //  - callback signature must be compatible with: void f (const Key &, std::uint8_t *);
@@ -184,22 +331,21 @@ public:
                              [] (const Key &, const auto & detail) { return false; },
                              [] (const Key &, const auto & detail, std::uint8_t *) {});
     }
-    std::uint64_t count () const {
-        std::uint64_t n = 0;
-        immutability guard (this->lock);
-        for (auto & shard : this->shards) {
-            n += shard.size (this);
-        }
-        return n;
+    std::size_t count (std::initializer_list <db::secondary> indexes, const eid & key,
+                       std::uint32_t oldest, std::uint32_t latest) const {
+        return this->select (indexes, key, oldest, latest,
+                             [] (const Key &, const auto & detail) { return true; },
+                             [] (const Key &, const auto & detail) { return false; },
+                             [] (const Key &, const auto & detail, std::uint8_t *) {});
     }
+    std::uint64_t count () const;
     std::uint64_t size () const { // alias to keep naming orthogonal with shards
         return this->count ();
     }
 
     // TODO: queries that will be needed later
-    //  - select all in thread
     //  - select all descending some parent entry
-    //  - select by identity (posts by someone) or by parent identity (all replies to someone)
+    //  - select by parent identity (all replies to someone)
 
 private:
     table (const table &) = delete;
@@ -213,6 +359,45 @@ private:
 
     bool need_shard_to_advance (const shard <Key> *) const;
 
+    // matches
+    //  - evaluates 'filter' against content summary of the row, or empty summary if there is none
+    //
+    static bool matches (const summary_query & filter, const Key & row) {
+        if constexpr (Key::summarized)
+            return filter.matches (row.type);
+        else
+            return filter.matches (content::summary {});
+    }
+
+    // advance_shard
+    //  - advances the shard (if marked, see 'need_shard_to_advance') and updates its count
+    //
+    void advance_shard (shard <Key> *) const;
+
+    // checkpoint
+    //  - flushes open shards and empties the journal, if anything was journaled
+    //  - required before shard files are changed other way than by append, requires 'lock' held
+    //
+    void checkpoint () const;
+
+    // replay
+    //  - rewrites data of journaled appends into shard files and flushes them, called by 'reload'
+    //
+    bool replay ();
+
+    // recount
+    //  - updates 'counts' for the shard after its size might have changed
+    //  - invalidate_counts - forces rebuild after 'shards' change, requires exclusive 'lock'
+    //
+    void recount (const shard <Key> *) const;
+    void invalidate_counts () const;
+    void unsynchronized_rebuild_counts () const;
+
+    // process
+    //  - Monitor notification of changed file in table directory (reader only)
+    //  - appended shards read new rows, replaced (split/compacted) are closed to reload on access,
+    //    new shards are inserted and removed ones are dropped
+    //
     virtual bool process (const std::wstring & filename) override;
     virtual std::wstring render_directory_path () const override {
         return this->db.table_directory_path (this->name);
@@ -14,6 +14,9 @@ bool raddi::db::table <Key>::reload () {
             return true;
 
         case directory::already_exists:
+            if (this->db.mode == file::access::write) {
+                this->replay ();
+            }
             try {
                 std::vector <std::uint32_t> timestamps;
                 timestamps.reserve (4096);
@@ -36,6 +39,7 @@ bool raddi::db::table <Key>::reload () {
                     for (const auto timestamp : timestamps) {
                         this->shards.emplace_back (timestamp, this);
                     }
+                    this->invalidate_counts ();
                     return true;
                 }
             } catch (const std::bad_alloc &) {
@@ -45,6 +49,200 @@ bool raddi::db::table <Key>::reload () {
     return false;
 }
 
+template <typename Key>
+std::vector <std::uint32_t> raddi::db::table <Key>::unloaded (std::size_t n) const {
+    std::vector <std::uint32_t> bases;
+    immutability guard (this->lock);
+
+    for (auto i = this->shards.rbegin (); (i != this->shards.rend ()) && (bases.size () < n); ++i) {
+        if (i->closed ()) {
+            bases.push_back (i->base);
+        }
+    }
+    return bases;
+}
+
+template <typename Key>
+bool raddi::db::table <Key>::warm (std::uint32_t base) const {
+    immutability guard (this->lock);
+
+    auto i = std::lower_bound (this->shards.begin (), this->shards.end (), base);
+    if ((i != this->shards.end ()) && (i->base == base) && i->closed ()) {
+        this->advance_shard (&*i);
+        return !i->closed ();
+    } else
+        return false;
+}
+
+template <typename Key>
+std::vector <std::uint32_t> raddi::db::table <Key>::expired (std::uint32_t threshold) const {
+    std::vector <std::uint32_t> bases;
+    immutability guard (this->lock);
+
+    for (std::size_t i = 0; (i + 1 < this->shards.size ()) && (this->shards [i + 1].base <= threshold); ++i) {
+        bases.push_back (this->shards [i].base);
+    }
+    return bases;
+}
+
+template <typename Key>
+    template <typename F>
+bool raddi::db::table <Key>::retire (std::uint32_t base, std::uint32_t threshold, F keep) {
+    exclusive guard (this->lock);
+
+    // shards might have been split or removed since 'expired' was called
+
+    auto i = std::lower_bound (this->shards.begin (), this->shards.end (), base);
+    if ((i == this->shards.end ()) || (i->base != base) || (i + 1 == this->shards.end ()) || ((i + 1)->base > threshold))
+        return false;
+
+    this->checkpoint ();
+    switch (i->retire (this, keep)) {
+        case 0:
+            this->shards.erase (i);
+            this->invalidate_counts ();
+            return true;
+        case (std::size_t) -1:
+            return false;
+        default:
+            this->recount (&*i);
+            return true;
+    }
+}
+
+template <typename Key>
+std::vector <std::uint32_t> raddi::db::table <Key>::inactive (std::uint32_t threshold) const {
+    std::vector <std::uint32_t> bases;
+    immutability guard (this->lock);
+
+    for (const auto & s : this->shards) {
+        if (raddi::older (s.accessed, threshold)) {
+            bases.push_back (s.base);
+        }
+    }
+    return bases;
+}
+
+template <typename Key>
+bool raddi::db::table <Key>::compact (std::uint32_t base, unsigned int threshold) {
+    const auto locate = [this, base] () -> shard <Key> * {
+        auto i = std::lower_bound (this->shards.begin (), this->shards.end (), base);
+        if ((i != this->shards.end ()) && (i->base == base))
+            return &*i;
+        else
+            return nullptr;
+    };
+
+    typename shard <Key>::compaction compaction;
+    {
+        immutability guard (this->lock);
+        auto s = locate ();
+        if (!s || !s->prepare (this, threshold, compaction))
+            return false;
+    }
+
+    // the content is copied by temporary object, shards may be moved in memory meanwhile
+
+    const shard <Key> temporary (base);
+    if (!temporary.copy (this, compaction))
+        return false;
+
+    bool compacted = false;
+    {
+        exclusive guard (this->lock);
+        if (auto s = locate ()) {
+
+            // journal may contain appends at offsets that are being replaced
+
+            this->checkpoint ();
+            compacted = s->commit (this, compaction);
+            this->recount (s);
+        }
+    }
+
+    DeleteFile (temporary.path (this, shard <Key>::stream::content_copy).c_str ());
+    return compacted;
+}
+
+template <typename Key>
+    template <typename F>
+std::size_t raddi::db::table <Key>::verify (std::uint32_t base, F check, bool repair, std::size_t * rows, std::size_t * repaired) {
+    const auto locate = [this, base] () -> shard <Key> * {
+        auto i = std::lower_bound (this->shards.begin (), this->shards.end (), base);
+        if ((i != this->shards.end ()) && (i->base == base))
+            return &*i;
+        else
+            return nullptr;
+    };
+
+    if (rows) {
+        *rows = 0;
+    }
+    if (repaired) {
+        *repaired = 0;
+    }
+
+    // 'check' may look up other entries (e.g. parents) through the table and its shards,
+    // so rows are only listed and read under the locks and checked with no lock held
+
+    std::vector <Key> listed;
+    {
+        immutability guard (this->lock);
+        if (auto s = locate ()) {
+            if (!s->list (this, listed))
+                return (std::size_t) -1;
+
+            this->recount (s);
+        } else
+            return 0;
+    }
+
+    std::vector <decltype (Key::id)> invalid;
+    struct : public raddi::entry {
+        std::uint8_t description [raddi::entry::max_content_size];
+    } data;
+
+    for (const auto & row : listed) {
+        Key current;
+        const wchar_t * failure = nullptr;
+        {
+            immutability guard (this->lock);
+            if (auto s = locate ()) {
+                if (!s->inspect (this, row.id, &current, &data, &failure))
+                    continue; // erased or moved in the meantime
+            } else
+                break;
+        }
+
+        if (!failure) {
+            failure = check (current, &data, current.data.length + sizeof (raddi::entry));
+        }
+        if (failure) {
+            this->report (log::level::data, 10, base, row.id.serialize (), failure);
+            invalid.push_back (row.id);
+        }
+    }
+
+    if (rows) {
+        *rows = listed.size ();
+    }
+
+    if (repair && !invalid.empty () && (this->db.mode == file::access::write)) {
+        exclusive guard (this->lock);
+        if (auto s = locate ()) {
+            this->checkpoint ();
+
+            const auto n = s->repair (this, invalid);
+            this->recount (s);
+
+            if (repaired) {
+                *repaired = n;
+            }
+        }
+    }
+    return invalid.size ();
+}
+
 template <typename Key>
 void raddi::db::table <Key>::flush () {
     immutability guard (this->lock);
@@ -53,35 +251,171 @@ void raddi::db::table <Key>::flush () {
             shard.flush ();
         }
     }
+    this->wal.checkpoint ();
+}
+
+template <typename Key>
+bool raddi::db::table <Key>::write_ahead (const journal::record & record, const void * rows, const void * content) const {
+    if (this->db.settings.write_ahead_journal) {
+        if (!this->wal.append (record, rows, content)) {
+            this->report (log::level::error, 35, this->wal.path);
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Key>
+void raddi::db::table <Key>::checkpoint () const {
+    if (!this->wal.empty ()) {
+        for (auto & shard : this->shards) {
+            if (!shard.closed ()) {
+                shard.flush ();
+            }
+        }
+        this->wal.checkpoint ();
+    }
+}
+
+template <typename Key>
+bool raddi::db::table <Key>::replay () {
+    std::vector <std::pair <file, file>> written;
+    bool failed = false;
+
+    // records are applied in order, later appends to the same shard may overwrite earlier data
+    //  - files are opened as needed and kept open until flushed
+
+    std::uintmax_t torn = 0;
+    const auto n = this->wal.replay ([this, &written, &failed] (const journal::record & record,
+                                                                const std::uint8_t * rows, const std::uint8_t * content) {
+        const shard <Key> temporary (record.base);
+
+        file index;
+        file data;
+        if (!data.open (temporary.path (this, shard <Key>::stream::content), file::mode::always, file::access::write, file::share::read)
+                || !index.open (temporary.path (this, shard <Key>::stream::index), file::mode::always, file::access::write, file::share::read)
+                || (data.seek (record.content_position) != record.content_position)
+                || !data.write (content, record.content_length)
+                || (index.seek (record.index_position) != record.index_position)
+                || !index.write (rows, record.index_length)) {
+
+            this->report (log::level::error, 36, this->wal.path, temporary.path (this));
+            failed = true;
+            return false;
+        }
+        try {
+            written.emplace_back (std::move (index), std::move (data));
+        } catch (const std::bad_alloc &) {
+            index.flush ();
+            data.flush ();
+        }
+        return true;
+    }, &torn);
+
+    if (n == (std::size_t) -1)
+        return true; // no journal
+
+    for (auto & files : written) {
+        files.second.flush (); // content before index
+        files.first.flush ();
+    }
+
+    this->report (log::level::event, 21, this->wal.path, n, torn);
+
+    if (failed)
+        return false; // journal is kept for next attempt
+    else
+        return this->wal.discard ();
 }
 
 template <typename Key>
 bool raddi::db::table <Key>::insert (const entry * entry, std::size_t size, const root & top, bool & exists) {
     try {
         exclusive guard (this->lock);
-        return this->unsynchronized_get_shard (entry->id.timestamp)->insert (this, entry, size, top, exists);
+
+        const auto shard = this->unsynchronized_get_shard (entry->id.timestamp);
+        const auto result = shard->insert (this, entry, size, top, exists);
+
+        this->recount (shard);
+        return result;
     } catch (const std::bad_alloc &) {
         exists = false;
         return false;
     }
 }
 
+template <typename Key>
+std::size_t raddi::db::table <Key>::insert (std::vector <insertion *> & items) {
+    std::stable_sort (items.begin (), items.end (),
+                      [] (const insertion * a, const insertion * b) { return a->entry->id.timestamp < b->entry->id.timestamp; });
+
+    std::size_t n = 0;
+    auto i = items.begin ();
+    auto e = items.end ();
+
+    while (i != e) {
+        try {
+            exclusive guard (this->lock);
+
+            // group of items for the same shard
+            //  - all items following first one that are older than next shard's base
+
+            const auto shard = this->unsynchronized_get_shard ((*i)->entry->id.timestamp);
+            const auto next = static_cast <std::size_t> (shard - &this->shards [0]) + 1;
+            const auto upper = (next < this->shards.size ()) ? this->shards [next].base : 0xFFFF'FFFFu;
+            const auto limit = std::max (this->db.settings.insert_batch_size, 1u);
+
+            auto g = i;
+            do {
+                ++g;
+            } while ((g != e) && (std::size_t (g - i) < limit) && ((*g)->entry->id.timestamp < upper));
+
+            n += shard->insert (this, &*i, std::size_t (g - i));
+            i = g;
+
+            this->recount (shard);
+
+        } catch (const std::bad_alloc &) {
+            (*i)->exists = false;
+            (*i)->inserted = false;
+            ++i;
+        }
+    }
+    return n;
+}
+
 template <typename Key>
 bool raddi::db::table <Key>::erase (const decltype (Key::id) & entry, bool thorough) {
     immutability guard (this->lock);
     if (auto shard = this->unsynchronized_find_shard (entry.timestamp)) {
-        return shard->erase (this, entry, thorough);
+        this->checkpoint ();
+        if (shard->erase (this, entry, thorough)) {
+            this->recount (shard);
+            return true;
+        } else
+            return false;
     } else
         return false;
 }
 
+template <typename Key>
+raddi::db::table <Key>::~table () {
+    this->stop (); // Monitor, completion must not call 'process' of destroyed table
+
+    exclusive guard (this->lock);
+    for (auto & s : this->shards) {
+        s.close (this);
+    }
+}
+
 template <typename Key>
 bool raddi::db::table <Key>::get (const decltype (Key::id) & entry, Key * r) const {
     immutability guard (this->lock);
     if (auto shard = this->unsynchronized_find_shard (entry.timestamp)) {
-        if (this->need_shard_to_advance (shard)) {
-            shard->advance (this);
-        }
+        if (!shard->may_contain (this, entry))
+            return false;
+
+        this->advance_shard (shard);
         return shard->get (this, entry, r);
     } else
         return false;
@@ -92,9 +426,10 @@ bool raddi::db::table <Key>::get (const decltype (Key::id) & entry, read what,
                                   void * buffer, std::size_t * length, std::size_t demand) const {
     immutability guard (this->lock);
     if (auto shard = this->unsynchronized_find_shard (entry.timestamp)) {
-        if (this->need_shard_to_advance (shard)) {
-            shard->advance (this);
-        }
+        if (!shard->may_contain (this, entry))
+            return false;
+
+        this->advance_shard (shard);
         return shard->get (this, entry, what, buffer, length, demand);
     } else
         return false;
@@ -104,19 +439,44 @@ template <typename Key>
 bool raddi::db::table <Key>::get (std::uint64_t index, read what,
                                   void * buffer, std::size_t * length, std::size_t demand) const {
     immutability guard (this->lock);
-    for (auto & shard : this->shards) {
-        auto ss = shard.size (this);
 
-        if (index >= ss) {
-            index -= ss;
-        } else {
-            if (this->need_shard_to_advance (&shard)) {
-                shard.advance (this);
+    std::size_t position = 0;
+    {
+        exclusive guard2 (this->counts_lock);
+        if (!this->counted) {
+            this->unsynchronized_rebuild_counts ();
+        }
+
+        // descend the tree to the shard containing 'index'-th row
+
+        const auto n = this->counts.size ();
+        auto step = std::size_t (1);
+        while (step <= n / 2) {
+            step *= 2;
+        }
+        for (; step; step /= 2) {
+            if ((position + step <= n) && (this->counts [position + step - 1] <= index)) {
+                position += step;
+                index -= this->counts [position - 1];
             }
-            return shard.get (this, (std::size_t) index, what, buffer, length, demand);
         }
+        if (position >= n)
+            return false;
     }
-    return false;
+
+    auto & shard = this->shards [position];
+    this->advance_shard (&shard);
+    return shard.get (this, (std::size_t) index, what, buffer, length, demand);
+}
+
+template <typename Key>
+std::uint64_t raddi::db::table <Key>::count () const {
+    immutability guard (this->lock);
+    exclusive guard2 (this->counts_lock);
+    if (!this->counted) {
+        this->unsynchronized_rebuild_counts ();
+    }
+    return this->total;
 }
 
 template <typename Key>
@@ -131,9 +491,7 @@ bool raddi::db::table <Key>::top (Key * row) const {
     while (i != e) {
         auto shard = &*i;
 
-        if (this->need_shard_to_advance (shard)) {
-            shard->advance (this);
-        }
+        this->advance_shard (shard);
         if (shard->top (row))
             return true;
 
@@ -144,13 +502,70 @@ bool raddi::db::table <Key>::top (Key * row) const {
 
 template <typename Key>
 bool raddi::db::table <Key>::need_shard_to_advance (const shard <Key> * s) const {
-    if (s->closed ())
+    if (s->closed () || s->broken)
         return true;
 
     exclusive guard (this->advance_lock);
     return this->advance_marks.erase (s->base);
 }
 
+template <typename Key>
+void raddi::db::table <Key>::advance_shard (shard <Key> * s) const {
+    if (this->need_shard_to_advance (s)) {
+        s->advance (this);
+        this->recount (s);
+    }
+}
+
+template <typename Key>
+void raddi::db::table <Key>::recount (const shard <Key> * s) const {
+    exclusive guard (this->counts_lock);
+    if (this->counted) {
+        const auto position = std::size_t (s - &this->shards [0]);
+        const auto size = s->size (this);
+        const auto value = (size != static_cast <std::size_t> (-1)) ? size : 0u;
+
+        if (value != this->sizes [position]) {
+            const auto delta = std::uint64_t (value) - std::uint64_t (this->sizes [position]); // wraps for decrements
+
+            for (auto i = position + 1; i <= this->counts.size (); i += i & (0 - i)) {
+                this->counts [i - 1] += delta;
+            }
+            this->total += delta;
+            this->sizes [position] = value;
+        }
+    }
+}
+
+template <typename Key>
+void raddi::db::table <Key>::invalidate_counts () const {
+    exclusive guard (this->counts_lock);
+    this->counted = false;
+}
+
+template <typename Key>
+void raddi::db::table <Key>::unsynchronized_rebuild_counts () const {
+    const auto n = this->shards.size ();
+
+    this->sizes.resize (n);
+    this->counts.resize (n);
+    this->total = 0;
+
+    for (std::size_t i = 0; i != n; ++i) {
+        const auto size = this->shards [i].size (this);
+        this->sizes [i] = (size != static_cast <std::size_t> (-1)) ? size : 0u;
+        this->counts [i] = this->sizes [i];
+        this->total += this->sizes [i];
+    }
+    for (std::size_t i = 1; i <= n; ++i) {
+        const auto j = i + (i & (0 - i));
+        if (j <= n) {
+            this->counts [j - 1] += this->counts [i - 1];
+        }
+    }
+    this->counted = true;
+}
+
 template <typename Key>
 raddi::db::shard <Key> * raddi::db::table <Key>::unsynchronized_get_shard (std::uint32_t timestamp) {
 
@@ -158,6 +573,7 @@ raddi::db::shard <Key> * raddi::db::table <Key>::unsynchronized_get_shard (std::
 
     if (this->shards.empty () || (timestamp >= (this->shards.back ().base + this->db.settings.forward_granularity))) {
         this->shards.emplace_back (timestamp, this);
+        this->invalidate_counts ();
         return &this->shards.back ();
     }
 
@@ -168,6 +584,7 @@ raddi::db::shard <Key> * raddi::db::table <Key>::unsynchronized_get_shard (std::
         while (ts > timestamp) {
             ts -= this->db.settings.backtrack_granularity;
         }
+        this->invalidate_counts ();
         return &*this->shards.emplace (this->shards.begin (), ts, this);
     }
 
@@ -184,8 +601,9 @@ raddi::db::shard <Key> * raddi::db::table <Key>::unsynchronized_get_shard (std::
         // if inserting timestamp highest than the largest already in this latest shard
         // and that shard would be likely split soon, then create new shard
 
-        if ((i->cache.size () >= this->db.settings.minimum_shard_size) && (timestamp > i->cache.crbegin ()->id.timestamp)) {
+        if ((i->cache.size () >= this->db.settings.minimum_shard_size) && (timestamp > i->cache.back ().id.timestamp)) {
             this->shards.emplace_back (timestamp, this);
+            this->invalidate_counts ();
             return &this->shards.back ();
         }
 
@@ -194,27 +612,24 @@ raddi::db::shard <Key> * raddi::db::table <Key>::unsynchronized_get_shard (std::
     }
 
     // split shard if size reaches or exceeds set maximum
-    // TODO: use middle value, not average, so that we don't end up with empty shard
+    //  - at median timestamp so that both halves get about the same number of rows
 
     if (i->cache.size () >= this->db.settings.maximum_shard_size) {
 
-        auto divider = 0uLL;
-        auto next = i + 1;
-
-        if (next == this->shards.end ()) {
-            std::uint64_t ts = 0;
-            for (const auto & row : i->cache) {
-                ts += row.id.timestamp;
-            }
-            divider = ts / i->cache.size () + 1;
-        } else {
-            divider = i->base + (next->base - i->base - 1) / 2 + 1;
-        }
+        const auto divider = i->cache [i->cache.size () / 2].id.timestamp;
+        const auto next = i + 1;
 
         if (i->base < divider) {
             try {
+                this->checkpoint ();
+
                 // split throws int (API) or bad_alloc (caught above)
-                return &*this->shards.insert (next, i->split (this, (std::uint32_t) divider));
+                auto separated = this->shards.insert (next, i->split (this, divider));
+                this->invalidate_counts ();
+                if (timestamp >= divider)
+                    return &*separated;
+                else
+                    return &*(separated - 1);
             } catch (int) {
                 // split failed (API), already reported, continue
             }
@@ -254,7 +669,7 @@ std::size_t raddi::db::table <Key>::optimize (std::uint32_t threshold) {
     std::size_t n = 0;
     for (auto & s : this->shards) {
         if (raddi::older (s.accessed, threshold)) {
-            n += s.close ();
+            n += s.close (this);
         }
     }
     return n;
@@ -286,11 +701,36 @@ std::size_t raddi::db::table <Key>::prune (std::size_t keep) {
 
     std::size_t n = 0;
     for (std::size_t i = 0; i != tops; ++i) {
-        n += index [i].second->close ();
+        n += index [i].second->close (this);
     }
     return n;
 }
 
+template <typename Key>
+std::size_t raddi::db::table <Key>::usage (std::vector <db::usage> & list, unsigned int id) const {
+    immutability guard (this->lock);
+
+    std::size_t total = 0;
+    for (const auto & s : this->shards) {
+        if (auto bytes = s.footprint ()) {
+            list.push_back ({ s.accessed, s.base, bytes, id });
+            total += bytes;
+        }
+    }
+    return total;
+}
+
+template <typename Key>
+bool raddi::db::table <Key>::evict (std::uint32_t base, std::uint32_t accessed) {
+    immutability guard (this->lock);
+
+    auto i = std::lower_bound (this->shards.begin (), this->shards.end (), base);
+    if ((i != this->shards.end ()) && (i->base == base) && !raddi::older (accessed, i->accessed)) {
+        return i->close (this);
+    } else
+        return false;
+}
+
 template <typename Key>
 raddi::db::statistics raddi::db::table <Key>::stats () const {
     raddi::db::statistics s;
@@ -302,6 +742,7 @@ raddi::db::statistics raddi::db::table <Key>::stats () const {
         immutability shard_guard (shard.lock);
         if (!shard.closed ()) {
             s.rows += shard.cache.size ();
+            s.bytes += shard.unsynchronized_footprint ();
             s.shards.active += 1;
         }
     }
@@ -320,32 +761,90 @@ void raddi::db::table <Key>::enumerate_shard_info (T callback) const {
 
 template <typename Key>
 bool raddi::db::table <Key>::process (const std::wstring & filename) {
+
+    // only shard index files are of interest, content is always written before index
+    //  - temporary files of split and compaction are ignored, those are renamed when complete
+
+    wchar_t * tail = nullptr;
+    const auto base = (std::uint32_t) std::wcstoul (filename.c_str (), &tail, 16);
+    if ((tail != filename.c_str () + 8) || (std::wcscmp (tail, L".i") != 0))
+        return true;
+
+    std::uint32_t upper = raddi::now ();
     {
         exclusive guard (this->lock);
 
-        // exclusive guard (this->advance_lock);
-        // this->advance_marks.insert (...);
-
-        // NOTE: This needs to be implemented for any client software to work
-        // TODO: handle external changes:
-        //    - close all shards reported as new?
-        //    - mark referenced shard 'filename' to advance,
-        //    - if new then either split happened (reload table) or append happened (???)
-        //       - some shard can be pointing to file about to be deleted
+        file f;
+        const auto present = f.open (this->db.table_directory_path (this->name) + filename,
+                                     file::mode::open, file::access::query, file::share::full);
+        if (!present) {
+            switch (GetLastError ()) {
+                case ERROR_FILE_NOT_FOUND:
+                case ERROR_PATH_NOT_FOUND:
+                    break;
+                default:
+                    return false; // retry later
+            }
+        }
+        f.close ();
+
+        auto i = std::lower_bound (this->shards.begin (), this->shards.end (), base);
+        if ((i != this->shards.end ()) && (i->base == base)) {
+            if (present) {
+                if (i->replaced (this)) {
+                    i->close (); // rewritten by split or compaction, will be loaded again on access
+                    i->invalidate_filter ();
+                } else if (!i->closed ()) {
+                    if (!i->advance (this)) { // reads only newly appended rows
+                        exclusive guard2 (this->advance_lock);
+                        this->advance_marks.insert (base);
+                    }
+                } else {
+                    i->invalidate_filter (); // appended to, filter will be reloaded if updated
+                }
+                this->recount (&*i);
+            } else {
+                i = this->shards.erase (i); // removed
+                this->invalidate_counts ();
 
-        // TODO: this is run on different thread!
+                if (i != this->shards.end ()) {
+                    upper = i->base - 1;
+                }
+                i = this->shards.end ();
+            }
+        } else {
+            if (!present)
+                return true;
+
+            // new shard, either newest one, or split from preceding shard
+            //  - preceding index may be rewritten but not yet reported
+
+            i = this->shards.emplace (i, base, this);
+            if (i != this->shards.begin ()) {
+                auto previous = i - 1;
+                if (previous->replaced (this)) {
+                    previous->close ();
+                    previous->invalidate_filter ();
+                }
+            }
+            this->invalidate_counts ();
+        }
 
+        if ((i != this->shards.end ()) && (i + 1 != this->shards.end ())) {
+            upper = (i + 1)->base - 1;
+        }
     }
+
     if (this->reader_change_notification_callback) {
-        // TODO: report range of changes: shard, and upper bound (next shard - 1 or now())
-        this->reader_change_notification_callback (this->notification_callback_context, 0, 0);
+        this->reader_change_notification_callback (this->notification_callback_context, base, upper);
     }
     return true;
 }
 
 template <typename Key>
     template <typename T, typename U, typename V>
-std::size_t raddi::db::table <Key>::select (std::uint32_t oldest, std::uint32_t latest, T constrain, U query, V callback) const {
+std::size_t raddi::db::table <Key>::select (const summary_query & filter, std::uint32_t oldest, std::uint32_t latest,
+                                            T constrain, U query, V callback) const {
     struct {
         std::uint32_t shard = 0;
         std::uint32_t index = 0; // row index in current shard
@@ -361,22 +860,83 @@ std::size_t raddi::db::table <Key>::select (std::uint32_t oldest, std::uint32_t
         if (raddi::older (latest, shard.base)) { // shard.base > latest
             break; // we are done
         }
-        if (this->need_shard_to_advance (&shard)) {
-            shard.advance (this);
+        if (!shard.may_match (filter)) {
+            continue; // no row can match, not even loaded
+        }
+        this->advance_shard (&shard);
+
+        info.shard = shard.base;
+        info.index = 0;
+        info.count = shard.size (this);
+
+        shard.enumerate (this, [&info, &filter, oldest, latest, constrain, query, callback] (const Key & row, std::uint8_t * data) -> bool {
+            bool r = false;
+            if (data) {
+                callback (row, info, data);
+                return false;
+
+            } else {
+                if (!raddi::older (row.id.timestamp, oldest) && raddi::older (row.id.timestamp, latest + 1) && matches (filter, row)) {
+                    if (constrain (row, info)) {
+                        ++info.match;
+                        r = query (row, info);
+                    }
+                }
+                ++info.index;
+                ++info.total;
+                return r;
+            }
+        });
+    }
+    return info.match;
+}
+
+template <typename Key>
+    template <typename T, typename U, typename V>
+std::size_t raddi::db::table <Key>::select (const summary_query & filter,
+                                            std::initializer_list <db::secondary> indexes, const eid & key,
+                                            std::uint32_t oldest, std::uint32_t latest, T constrain, U query, V callback) const {
+    struct {
+        std::uint32_t shard = 0;
+        std::uint32_t index = 0; // position within matching rows in current shard
+        std::size_t   count = 0; // row count in current shard
+
+        std::size_t   total = 0; // total evaluated entries in shards
+        std::size_t   match = 0; // total rows matching timestamp range and constrain
+    } info;
+
+    immutability guard (this->lock);
+
+    // skip shards whose successor begins at or before 'oldest', those contain only older rows
+
+    auto i = std::upper_bound (this->shards.begin (), this->shards.end (), oldest);
+    if (i != this->shards.begin ()) {
+        --i;
+    }
+
+    for (auto e = this->shards.end (); i != e; ++i) {
+        auto & shard = *i;
+
+        if (raddi::older (latest, shard.base)) { // shard.base > latest
+            break; // we are done
+        }
+        if (!shard.may_match (filter)) {
+            continue; // no row can match, not even loaded
         }
+        this->advance_shard (&shard);
 
         info.shard = shard.base;
         info.index = 0;
         info.count = shard.size (this);
 
-        shard.enumerate (this, [&info, oldest, latest, constrain, query, callback] (const Key & row, std::uint8_t * data) -> bool {
+        shard.enumerate (this, indexes, key, [&info, &filter, oldest, latest, constrain, query, callback] (const Key & row, std::uint8_t * data) -> bool {
             bool r = false;
             if (data) {
                 callback (row, info, data);
                 return false;
 
             } else {
-                if (!raddi::older (row.id.timestamp, oldest) && raddi::older (row.id.timestamp, latest + 1)) {
+                if (!raddi::older (row.id.timestamp, oldest) && raddi::older (row.id.timestamp, latest + 1) && matches (filter, row)) {
                     if (constrain (row, info)) {
                         ++info.match;
                         r = query (row, info);
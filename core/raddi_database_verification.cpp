@@ -0,0 +1,123 @@
+#include <windows.h>
+
+#include <algorithm>
+
+#include "raddi_database.h"
+#include "raddi_database_row.h"
+#include "raddi_database_shard.h"
+#include "raddi_database_table.h"
+
+#include "raddi_identity.h"
+#include "raddi_timestamp.h"
+
+raddi::db::verification raddi::db::verify (bool repair, unsigned int threads) {
+    if (threads == 0) {
+        SYSTEM_INFO si;
+        GetSystemInfo (&si);
+        threads = si.dwNumberOfProcessors;
+    }
+
+    // parent
+    //  - parent of regular entry is another entry, channel or identity (for identity channel)
+    //
+    const auto parent_exists = [this] (const eid & parent) {
+        if (parent.identity.timestamp != parent.timestamp)
+            return this->data->get (parent)
+                || this->channels->get (parent);
+        else
+            return this->identities->get (parent.identity);
+    };
+
+    // signature
+    //  - validates entry and verifies both proof-of-work and signature against author's public key
+    //
+    const auto signature_failure = [this] (const raddi::entry * entry, std::size_t size) -> const wchar_t * {
+        if (!raddi::entry::validate (entry, size))
+            return L"malformed";
+        if (!entry->proof (size))
+            return L"missing proof-of-work";
+
+        if (entry->is_announcement () == raddi::entry::new_identity_announcement) {
+            if (!static_cast <const raddi::identity *> (entry)->verify (size))
+                return L"signature or proof-of-work does not verify";
+        } else {
+            struct : public raddi::identity {
+                std::uint8_t description [raddi::identity::max_description_size];
+            } author;
+
+            if (!this->identities->get (entry->id.identity, read::content, &author, nullptr, sizeof (identity::public_key)))
+                return L"unknown author";
+            if (!entry->verify (size, author.public_key))
+                return L"signature or proof-of-work does not verify";
+        }
+        return nullptr;
+    };
+
+    const auto announcement = [signature_failure] (const auto &, const raddi::entry * entry, std::size_t size) {
+        return signature_failure (entry, size);
+    };
+    const auto thread = [this] (const trow & row, const raddi::entry *, std::size_t) -> const wchar_t * {
+        if (!this->data->get (row.id))
+            return L"missing in data table"; // verified there
+        else
+            return nullptr;
+    };
+    const auto regular = [signature_failure, parent_exists] (const row &, const raddi::entry * entry, std::size_t size) -> const wchar_t * {
+        if (auto failure = signature_failure (entry, size))
+            return failure;
+        if (!parent_exists (entry->parent))
+            return L"missing parent";
+        return nullptr;
+    };
+
+    // one job per shard
+    //  - announcement tables are verified first, entries of other tables are verified against them
+
+    std::vector <verification> results;
+    try {
+        batch work;
+
+        const auto schedule = [&work, repair, &results] (auto * table, auto check) {
+            table->enumerate_shard_info ([&work, table, check, repair, &results] (std::uint32_t base, std::size_t) {
+                const auto index = results.size ();
+                results.emplace_back ();
+
+                work.jobs.push_back ([table, check, repair, &results, index, base] {
+                    auto & result = results [index];
+                    auto invalid = table->verify (base, check, repair, &result.rows, &result.repaired);
+                    if (invalid != (std::size_t) -1) {
+                        result.shards = 1;
+                        result.invalid = invalid;
+                    }
+                    return false;
+                });
+                return true;
+            });
+        };
+
+        schedule (this->identities.get (), announcement);
+        work.start (threads);
+        work.wait ();
+
+        work.jobs.clear ();
+        schedule (this->channels.get (), announcement);
+        schedule (this->threads.get (), thread);
+        schedule (this->data.get (), regular);
+        work.start (threads);
+        work.wait ();
+
+    } catch (const std::bad_alloc &) {
+        this->report (log::level::error, 21);
+    }
+
+    verification total;
+    for (const auto & result : results) {
+        total.shards += result.shards;
+        total.rows += result.rows;
+        total.invalid += result.invalid;
+        total.repaired += result.repaired;
+    }
+
+    this->report (log::level::event, 19, total.shards, total.rows, total.invalid, total.repaired);
+    return total;
+}
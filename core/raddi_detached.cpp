@@ -1,71 +1,228 @@
 #include "raddi_detached.h"
 #include "raddi_entry.h"
+#include "raddi_timestamp.h"
 #include "../common/file.h"
 #include <algorithm>
-#include <set>
+#include <cstring>
+
+raddi::detached::detached (std::size_t limit)
+    : limit (std::min <std::size_t> (limit, 0x7FFF'FFFF) & ~(std::size_t) (alignment - 1)) {}
 
 void raddi::detached::insert (const eid & parent, const entry * entry, std::size_t size) {
-    auto data = reinterpret_cast <const std::uint8_t *> (entry);
+    const auto span = (sizeof (record) + size + alignment - 1) & ~(std::size_t) (alignment - 1);
+    if (span > this->limit)
+        return;
 
     exclusive guard (this->lock);
-    this->data [parent.timestamp].emplace (parent.identity, std::vector <std::uint8_t> (data, data + size));
+    if (this->arena.empty ()) {
+        this->arena.resize (this->limit);
+    }
+
+    // evict oldest records until contiguous space is available
+    //  - terminates at latest when arena is empty
+
+    while (!this->unsynchronized_fits ((std::uint32_t) span)) {
+        this->unsynchronized_reclaim (0, true);
+    }
+
+    const auto offset = this->head;
+    auto r = this->at (offset);
+    r->parent = parent;
+    r->size = (std::uint32_t) size;
+    r->span = (std::uint32_t) span;
+    r->arrived = raddi::now ();
+    r->previous = none;
+    r->next = none;
+    std::memcpy (r + 1, entry, size);
+
+    auto c = this->index.try_emplace (parent, chain { offset, offset });
+    if (!c.second) {
+        r->previous = c.first->second.last;
+        this->at (c.first->second.last)->next = offset;
+        c.first->second.last = offset;
+    }
+
+    this->head += (std::uint32_t) span;
+    this->used += (std::uint32_t) span;
+    if (this->head == this->arena.size ()) {
+        this->head = 0;
+    }
+
+    this->count += 1;
+    this->bytes += span;
     this->inserted += size;
 
-    auto current = this->unsynchronized_size ();
-    if (this->highwater.n < current.n || this->highwater.bytes < current.bytes) {
-        this->highwater = current;
+    if (this->highwater.n < this->count || this->highwater.bytes < this->bytes) {
+        this->highwater.n = this->count;
+        this->highwater.bytes = this->bytes;
         this->highwater_time = raddi::now ();
     }
 }
 
-std::size_t raddi::detached::reject (const eid & parent) {
-    exclusive guard (this->lock);
-    return this->unsynchronized_recursive_erase (parent);
+bool raddi::detached::unsynchronized_fits (std::uint32_t span) {
+    const auto capacity = (std::uint32_t) this->arena.size ();
+
+    if (this->used == 0) {
+        this->head = 0;
+        this->tail = 0;
+        return span <= capacity;
+    }
+
+    if (this->head > this->tail) {
+        if (capacity - this->head >= span)
+            return true;
+
+        if (this->tail >= span) {
+
+            // pad rest of the arena and wrap around
+            //  - too short rest, that can't hold a record header, is skipped implicitly by 'reclaim'
+
+            if (capacity - this->head >= sizeof (record)) {
+                auto r = this->at (this->head);
+                r->size = 0;
+                r->span = capacity - this->head;
+            }
+            this->used += capacity - this->head;
+            this->head = 0;
+            return true;
+        }
+        return false;
+    } else
+        return this->tail - this->head >= span; // head == tail here means full
 }
 
-std::size_t raddi::detached::unsynchronized_recursive_erase (const eid & parent, unsigned int iteration) {
+bool raddi::detached::unsynchronized_reclaim (std::uint32_t threshold, bool force) {
+    const auto capacity = (std::uint32_t) this->arena.size ();
 
-    // TODO: improve protection from endless loops caused by malformed (cycling) data
-    //  - get local ptr address and compare to GetCurrentThreadStackLimits (); (Win8) or get base from TEB and size from PE header
+    if (this->used == 0)
+        return false;
 
-    if (iteration > 2048)
-        return 0;
+    if (capacity - this->tail < sizeof (record)) {
+        this->used -= capacity - this->tail;
+        this->tail = 0;
+    } else {
+        auto r = this->at (this->tail);
+        if (r->size) {
+            if (!force && !raddi::older (r->arrived, threshold))
+                return false;
+            if (force) {
+                this->evicted += r->size;
+            }
+            this->unsynchronized_release (this->tail);
+        }
+
+        this->used -= r->span;
+        this->tail += r->span;
+        if (this->tail == capacity) {
+            this->tail = 0;
+        }
+    }
+
+    if (this->used == 0) {
+        this->head = 0;
+        this->tail = 0;
+    }
+    return true;
+}
 
-    auto mm = this->data.find (parent.timestamp);
-    if (mm != this->data.end ()) {
-        
-        std::set <eid> grandparents;
+void raddi::detached::unsynchronized_unlink (std::uint32_t offset) {
+    const auto r = this->at (offset);
 
-        auto range = mm->second.equal_range (parent.identity);
-        for (auto i = range.first; i != range.second; ++i) {
-            grandparents.insert (reinterpret_cast <const entry *> (i->second.data ())->parent);
-            this->rejected += i->second.size ();
+    if (r->previous != none) {
+        this->at (r->previous)->next = r->next;
+    }
+    if (r->next != none) {
+        this->at (r->next)->previous = r->previous;
+    }
+    if (r->previous == none || r->next == none) {
+        auto i = this->index.find (r->parent);
+        if (i != this->index.end ()) {
+            if (r->previous == none) {
+                i->second.first = r->next;
+            }
+            if (r->next == none) {
+                i->second.last = r->previous;
+            }
+            if (i->second.first == none) {
+                this->index.erase (i);
+            }
         }
+    }
+}
+
+void raddi::detached::unsynchronized_release (std::uint32_t offset) {
+    const auto r = this->at (offset);
+
+    this->unsynchronized_unlink (offset);
+    this->count -= 1;
+    this->bytes -= r->span;
+    r->size = 0;
+}
+
+void raddi::detached::unsynchronized_take (const eid & parent,
+                                           std::vector <std::vector <std::uint8_t>> & entries,
+                                           std::vector <eid> & children) {
+    entries.clear ();
+    children.clear ();
+
+    auto i = this->index.find (parent);
+    if (i != this->index.end ()) {
+
+        // copy first, so that allocation failure leaves the chain intact
 
-        mm->second.erase (range.first, range.second);
+        for (auto offset = i->second.first; offset != none; offset = this->at (offset)->next) {
+            const auto r = this->at (offset);
+            const auto data = reinterpret_cast <const std::uint8_t *> (r + 1);
 
-        auto n = grandparents.size ();
-        for (const auto & grandparent : grandparents) {
-            n += this->unsynchronized_recursive_erase (grandparent, iteration + 1);
+            entries.emplace_back (data, data + r->size);
+            children.push_back (reinterpret_cast <const entry *> (data)->id);
         }
-        return n;
-    } else
-        return 0;
+
+        for (auto offset = i->second.first; offset != none; offset = this->at (offset)->next) {
+            const auto r = this->at (offset);
+            this->count -= 1;
+            this->bytes -= r->span;
+            r->size = 0;
+        }
+        this->index.erase (i);
+    }
 }
 
-void raddi::detached::clean (std::uint32_t age) {
+std::size_t raddi::detached::reject (const eid & parent) {
     exclusive guard (this->lock);
-    this->data.erase (this->data.begin (), this->data.lower_bound (raddi::now () - age)); // TODO: raddi::older?
-}
 
-counter raddi::detached::unsynchronized_size () const {
-    counter counter;
-    for (const auto & m : this->data) {
-        counter.bytes += sizeof m;
-        for (const auto & mm : m.second) {
-            counter.bytes += sizeof mm;
-            counter += mm.second.size ();
+    // chains are erased from index before descending into them
+    //  - every record is visited only once, malformed (cycling) data can't cause endless loop
+
+    std::size_t n = 0;
+    std::vector <eid> pending;
+    pending.push_back (parent);
+
+    while (!pending.empty ()) {
+        auto i = this->index.find (pending.back ());
+        pending.pop_back ();
+
+        if (i != this->index.end ()) {
+            for (auto offset = i->second.first; offset != none; offset = this->at (offset)->next) {
+                const auto r = this->at (offset);
+
+                pending.push_back (reinterpret_cast <const entry *> (r + 1)->id);
+                this->rejected += r->size;
+                this->count -= 1;
+                this->bytes -= r->span;
+                r->size = 0;
+                ++n;
+            }
+            this->index.erase (i);
         }
     }
-    return counter;
+    return n;
+}
+
+void raddi::detached::clean (std::uint32_t age) {
+    exclusive guard (this->lock);
+
+    const auto threshold = raddi::now () - age;
+    while (this->unsynchronized_reclaim (threshold, false))
+        ;
 }
@@ -6,101 +6,167 @@
 #include "raddi_eid.h"
 
 #include <vector>
-#include <map>
+#include <unordered_map>
 
 namespace raddi {
     struct entry;
 
     // detached
     //  - special cache for reordering entries that arrived before their parent entries
-    //  - optimized for efficiently dropping too old entries
+    //  - entries are kept in fixed-size arena (ring of records in arrival order), oldest are evicted when full
+    //  - records are chained per missing parent, 'index' maps parent EID to its chain
     //
     class detached {
         mutable ::lock lock;
 
-        // data
-        //  - key - timestamp of entry's PARENT's id
-        //  - value - key - identity id of entry's PARENT
-        //          - value - the entry to be inserted when parent arrives
+        // record
+        //  - header of every record in the arena, followed by entry data, padded to 'alignment'
+        //  - 'size' is 0 for already released (accepted, rejected) records and for padding at the end of the arena
+        //  - 'previous' and 'next' are offsets of records of the same parent, or 'none'
         //
-        std::map <std::uint32_t, std::multimap <raddi::iid, std::vector <std::uint8_t>>> data;
+        struct record {
+            eid           parent;
+            std::uint32_t size;
+            std::uint32_t span;
+            std::uint32_t arrived;
+            std::uint32_t previous;
+            std::uint32_t next;
+        };
+
+        // chain
+        //  - first and last record awaiting the same parent, in arrival order
+        //
+        struct chain {
+            std::uint32_t first;
+            std::uint32_t last;
+        };
+
+        static constexpr std::uint32_t none = 0xFFFF'FFFFu;
+        static constexpr std::uint32_t alignment = 8;
+
+        // arena
+        //  - allocated to 'limit' bytes on first insertion
+        //  - live data are between 'tail' (oldest record) and 'head' (next write), 'used' bytes, wrapping around
+        //
+        std::vector <std::uint8_t> arena;
+        std::uint32_t head = 0;
+        std::uint32_t tail = 0;
+        std::uint32_t used = 0;
+
+        std::unordered_map <eid, chain, eid::hash> index;
+        std::size_t count = 0; // live records
+        std::size_t bytes = 0; // spans of live records
 
     public:
+        const std::size_t limit;
+
         counter inserted;
-        counter rejected; // only actively rejected, data dropped by 'clean' = 'inserted' - 'processed' - 'rejected'
+        counter rejected; // only actively rejected, data dropped by 'clean' = 'inserted' - 'processed' - 'rejected' - 'evicted'
         counter processed;
+        counter evicted;
         counter highwater;
         std::uint32_t highwater_time = 0;
 
     public:
 
+        // detached
+        //  - 'limit' is hard bound, in bytes, of memory used for storing detached entries
+        //
+        explicit detached (std::size_t limit = 16 * 1024 * 1024);
+
         // insert
         //  - adds entry to detached cache
+        //  - evicts oldest entries to make room, entries larger than whole arena are dropped
         //
         void insert (const eid & parent, const entry * data, std::size_t size);
 
         // reject
         //  - erases also all entries whose 'parent' is ID of an entry being erased
+        //  - iterative, every record is released only once, so cycling data can't loop
         //  - returns number of entries erased
         //
         std::size_t reject (const eid & parent);
 
         // accept
-        //  - invokes 'callback' on every entry which has 'parent' as parent EID
-        //  - signature must be compatible with: void callback (std::uint8_t *, std::size_t)
+        //  - releases every entry which has 'parent' as parent EID
+        //  - then every entry whose parent is an entry accepted, i.e. releases whole chain breadth-first,
+        //    one generation at a time, so the callback must NOT call 'accept' itself
+        //  - callback is invoked outside of the lock, once per generation with all its entries, so that
+        //    they can be inserted into database together; it sets 'accepted [i]' for entries whose
+        //    children are to be released next, returning false stops and fails the whole operation
+        //  - signature must be compatible with:
+        //    bool callback (const std::vector <std::vector <std::uint8_t>> & entries, std::vector <bool> & accepted)
         //
         template <typename Callback>
         bool accept (const eid & parent, Callback callback) {
-            this->lock.acquire_exclusive ();
-
-            auto mm = this->data.find (parent.timestamp);
-            if (mm != this->data.end ()) {
-                try {
-                    auto range = mm->second.equal_range (parent.identity);
-
-                    std::vector <std::vector <std::uint8_t>> entries;
-                    entries.reserve (std::distance (range.first, range.second));
-
-                    for (auto i = range.first; i != range.second; ++i) {
-                        entries.emplace_back (std::move (i->second));
+            std::vector <eid> pending;
+            std::vector <eid> children;
+            std::vector <eid> generation;
+            std::vector <std::vector <std::uint8_t>> taken;
+            std::vector <std::vector <std::uint8_t>> entries;
+            std::vector <bool> accepted;
+
+            pending.push_back (parent);
+
+            while (!pending.empty ()) {
+                entries.clear ();
+                generation.clear ();
+                {
+                    exclusive guard (this->lock);
+                    for (const auto & p : pending) {
+                        this->unsynchronized_take (p, taken, children);
+
+                        for (std::size_t i = 0; i != taken.size (); ++i) {
+                            entries.push_back (std::move (taken [i]));
+                            generation.push_back (children [i]);
+                        }
                     }
+                }
 
-                    mm->second.erase (range.first, range.second);
-                    this->lock.release_exclusive ();
+                pending.clear ();
+                accepted.assign (entries.size (), false);
 
-                    for (const auto & e : entries) {
-                        if (callback (e.data (), e.size ())) {
-                            this->processed += e.size ();
-                        } else
-                            return false;
+                if (!entries.empty () && !callback (entries, accepted))
+                    return false;
+
+                for (std::size_t i = 0; i != entries.size (); ++i) {
+                    this->processed += entries [i].size ();
+                    if (accepted [i]) {
+                        pending.push_back (generation [i]);
                     }
-                } catch (...) {
-                    this->lock.release_exclusive ();
-                    throw;
                 }
-            } else {
-                this->lock.release_exclusive ();
             }
             return true;
         }
 
         // clean
-        //  - deletes all entries older than 'age'
+        //  - deletes all entries that are waiting longer than 'age'
+        //  - also reclaims space of released records at the end of the arena
         //
         void clean (std::uint32_t age);
 
         // size
-        //  - returns number of entries currently held and amount of memory used by entries and structures that hold them
-        //  - does not attempt to estimate allocation overhead
+        //  - returns number of entries currently held and amount of memory used by them (including record headers)
         //
         counter size () const {
             immutability guard (this->lock);
-            return this->unsynchronized_size ();
+
+            counter c;
+            c.n = this->count;
+            c.bytes = this->bytes;
+            return c;
         }
 
     private:
-        std::size_t unsynchronized_recursive_erase (const eid & parent, unsigned int iteration = 0);
-        counter unsynchronized_size () const;
+        record * at (std::uint32_t offset) {
+            return reinterpret_cast <record *> (&this->arena [offset]);
+        }
+
+        bool unsynchronized_fits (std::uint32_t span);
+        bool unsynchronized_reclaim (std::uint32_t threshold, bool force);
+        void unsynchronized_unlink (std::uint32_t offset);
+        void unsynchronized_release (std::uint32_t offset);
+        void unsynchronized_take (const eid & parent, std::vector <std::vector <std::uint8_t>> & entries, std::vector <eid> & children);
     };
 }
 
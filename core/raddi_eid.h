@@ -76,6 +76,18 @@ namespace raddi {
 
         static constexpr auto min_length = iid::min_length + 1 + 1;
         static constexpr auto max_length = iid::max_length + 1 + 2 * sizeof (timestamp);
+
+        // hash
+        //  - hasher for unordered containers and open-addressing tables keyed by eid
+        //
+        struct hash {
+            std::size_t operator () (const eid & id) const {
+                std::uint32_t h = id.timestamp * 0x9E3779B1u;
+                h ^= id.identity.timestamp * 0x85EBCA77u;
+                h ^= id.identity.nonce * 0xC2B2AE3Du;
+                return h ^ (h >> 15);
+            }
+        };
     };
 
     // translate
@@ -3,11 +3,114 @@
 #include "../common/file.h"
 #include "../common/log.h"
 #include <algorithm>
+#include <cstring>
+
+namespace {
+
+    // header
+    //  - of the noticed file, followed by 'count' EIDs
+    //
+    struct header {
+        char          magic [8];
+        std::uint32_t version;
+        std::uint32_t count;
+    };
+
+    static constexpr char noticed_magic [8] = { 'R', 'A', 'D', 'D', 'I', 'E', 'I', 'D' };
+    static constexpr std::uint32_t noticed_version = 1;
+}
+
+const raddi::noticed::bucket * raddi::noticed::find (std::uint32_t key) const {
+    if (this->ring.empty ())
+        return nullptr;
+
+    // fast typical case, recent entry
+
+    if (this->ring.back ().key == key)
+        return &this->ring.back ();
+
+    auto i = std::lower_bound (this->ring.begin (), this->ring.end (), key,
+                               [] (const bucket & b, std::uint32_t k) { return b.key < k; });
+    if ((i != this->ring.end ()) && (i->key == key))
+        return &*i;
+    else
+        return nullptr;
+}
+
+raddi::noticed::bucket & raddi::noticed::obtain (std::uint32_t key) {
+    if (this->ring.empty () || (this->ring.back ().key < key)) {
+        this->ring.emplace_back ();
+        this->ring.back ().key = key;
+        return this->ring.back ();
+    }
+    if (this->ring.back ().key == key)
+        return this->ring.back ();
+
+    auto i = std::lower_bound (this->ring.begin (), this->ring.end (), key,
+                               [] (const bucket & b, std::uint32_t k) { return b.key < k; });
+    if ((i == this->ring.end ()) || (i->key != key)) {
+        i = this->ring.emplace (i);
+        i->key = key;
+    }
+    return *i;
+}
+
+bool raddi::noticed::probe (const bucket & b, const eid & id) {
+    if (b.slots.empty ())
+        return false;
+
+    const auto mask = b.slots.size () - 1;
+    for (auto i = hash (id) & mask; !null (b.slots [i]); i = (i + 1) & mask) {
+        if (b.slots [i] == id)
+            return true;
+    }
+    return false;
+}
+
+bool raddi::noticed::place (bucket & b, const eid & id) {
+    const auto mask = b.slots.size () - 1;
+    auto i = hash (id) & mask;
+    for (; !null (b.slots [i]); i = (i + 1) & mask) {
+        if (b.slots [i] == id)
+            return false;
+    }
+    b.slots [i] = id;
+    b.count++;
+    return true;
+}
+
+void raddi::noticed::grow (bucket & b) {
+    std::vector <eid> previous (std::max <std::size_t> (16, 2 * b.slots.size ()), eid { iid { 0, 0 } });
+    previous.swap (b.slots);
+    b.count = 0;
+
+    for (const auto & id : previous) {
+        if (!null (id)) {
+            place (b, id);
+        }
+    }
+}
+
+bool raddi::noticed::unsynchronized_insert (const raddi::eid & id) {
+    if (null (id))
+        return false;
+
+    auto & b = this->obtain (id.timestamp / span);
+    if (probe (b, id))
+        return false;
+
+    if (2 * (b.count + 1) > b.slots.size ()) {
+        grow (b);
+    }
+    place (b, id);
+    ++this->total;
+    return true;
+}
 
 bool raddi::noticed::insert (const raddi::eid & id) {
     exclusive guard (this->lock);
-    if (this->data [id.timestamp].insert (id.identity).second) {
-        this->changed.insert (id.timestamp);
+    if (this->unsynchronized_insert (id)) {
+        this->changed = true;
         return true;
     } else
         return false;
@@ -16,35 +119,49 @@ bool raddi::noticed::insert (const raddi::eid & id) {
 void raddi::noticed::clean (std::uint32_t age) {
     exclusive guard (this->lock);
 
-    auto i = this->data.begin ();
-    const auto e = this->data.end ();
     const auto threshold = raddi::now () - age;
 
-    while (i != e) {
-        if (raddi::older (i->first, threshold)) {
-            i = this->data.erase (i);
-        } else {
-            ++i;
+    // whole buckets with all entries older than threshold
+
+    while (!this->ring.empty () && raddi::older (this->ring.front ().key * span + (span - 1), threshold)) {
+        this->total -= this->ring.front ().count;
+        this->ring.pop_front ();
+        this->changed = true;
+    }
+
+    // boundary bucket is rebuilt with remaining entries
+
+    if (!this->ring.empty () && raddi::older (this->ring.front ().key * span, threshold)) {
+        auto & b = this->ring.front ();
+
+        std::vector <eid> previous (b.slots.size (), eid { iid { 0, 0 } });
+        previous.swap (b.slots);
+
+        this->total -= b.count;
+        b.count = 0;
+
+        for (const auto & id : previous) {
+            if (!null (id) && !raddi::older (id.timestamp, threshold)) {
+                place (b, id);
+            }
         }
+        this->total += b.count;
+        this->changed = true;
     }
 }
+
 bool raddi::noticed::count (const raddi::eid & id) const {
     immutability guard (this->lock);
 
-    auto i = this->data.find (id.timestamp);
-    if (i != this->data.end ())
-        return i->second.count (id.identity);
+    if (auto b = this->find (id.timestamp / span))
+        return probe (*b, id);
     else
         return false;
 }
 
 std::size_t raddi::noticed::size () const {
     immutability guard (this->lock);
-    std::size_t n = 0;
-    for (const auto & sub : this->data) {
-        n += sub.second.size ();
-    }
-    return n;
+    return this->total;
 }
 
 bool raddi::noticed::parse (const wchar_t * string, std::uint32_t * output) {
@@ -54,80 +171,118 @@ bool raddi::noticed::parse (const wchar_t * string, std::uint32_t * output) {
     return (end - string) == 8;
 }
 
-bool raddi::noticed::load (const std::wstring & path) {
-    exclusive guard (this->lock);
+bool raddi::noticed::load (const std::wstring & path, const std::wstring & legacy) {
+    try {
+        {
+            exclusive guard (this->lock);
 
-    switch (directory::create (path.c_str ())) {
+            file f;
+            if (f.open (path, file::mode::open, file::access::read, file::share::read, file::buffer::sequential)) {
 
-        case directory::created:
-            return true;
+                header h;
+                if (!f.read (h)
+                        || std::memcmp (h.magic, noticed_magic, sizeof h.magic)
+                        || (h.version != noticed_version)
+                        || (f.size () != sizeof h + std::uintmax_t (h.count) * sizeof (eid))) {
+                    return raddi::log::error (component::database, 22, path);
+                }
 
-        default:
-        case directory::create_failed:
-            raddi::log::error (component::database, 22, path);
-            return false;
+                std::vector <eid> ids (h.count);
+                if (h.count && !f.read (ids.data (), ids.size () * sizeof (eid)))
+                    return raddi::log::error (component::database, 22, path);
 
-        case directory::already_exists:
-            try {
-                auto callback = [path, this] (const wchar_t * filename) {
-
-                    std::uint32_t key;
-                    if (raddi::noticed::parse (filename, &key)) {
-
-                        auto full = path + filename;
-                        auto & data = this->data [key];
-
-                        file f;
-                        if (f.open (full, file::mode::open, file::access::read, file::share::read, file::buffer::sequential)) {
-                            iid item;
-                            while (f.read (item)) {
-                                data.insert (item);
-                            }
-                        } else {
-                            raddi::log::error (component::database, 22, full);
-                        }
-                    }
-                };
-                return directory ((path + L"*").c_str ()) (callback)
-                    || raddi::log::error (component::database, 22, path);
-
-            } catch (const std::bad_alloc &) {
-                raddi::log::error (component::database, 21);
-                return false;
+                for (const auto & id : ids) {
+                    this->unsynchronized_insert (id);
+                }
+                return true;
+            }
+        }
+
+        // previous format, converted right away
+
+        std::vector <std::wstring> files;
+        if (!legacy.empty () && this->load_legacy (legacy, files)) {
+            if (this->save (path)) {
+                for (const auto & filename : files) {
+                    file::unlink (legacy + filename);
+                }
+                RemoveDirectory (legacy.c_str ());
             }
+        }
+        return true;
+
+    } catch (const std::bad_alloc &) {
+        raddi::log::error (component::database, 21);
+        return false;
     }
 }
 
-void raddi::noticed::save (const std::wstring & path) const {
-    immutability guard (this->lock);
+bool raddi::noticed::load_legacy (const std::wstring & path, std::vector <std::wstring> & files) {
+    exclusive guard (this->lock);
 
-    // enum files in directory and erase those not in data
+    auto callback = [path, this, &files] (const wchar_t * filename) {
 
-    auto unlinker = [this, path] (const wchar_t * filename) {
         std::uint32_t key;
         if (raddi::noticed::parse (filename, &key)) {
-            if (!this->data.count (key)) {
-                file::unlink (path + filename);
+
+            auto full = path + filename;
+
+            file f;
+            if (f.open (full, file::mode::open, file::access::read, file::share::read, file::buffer::sequential)) {
+                iid item;
+                while (f.read (item)) {
+                    eid id;
+                    id.timestamp = key;
+                    id.identity = item;
+                    this->unsynchronized_insert (id);
+                }
+                files.push_back (filename);
+            } else {
+                raddi::log::error (component::database, 22, full);
             }
         }
     };
-    directory ((path + L"*").c_str ()) (unlinker);
-    
-    // write all data
+    return directory ((path + L"*").c_str ()) (callback);
+}
+
+bool raddi::noticed::save (const std::wstring & path) const {
+    immutability guard (this->lock);
 
-    for (const auto & [key, iids] : this->data) {
-        if (this->changed.count (key)) {
+    if (!this->changed)
+        return true;
 
-            wchar_t k [9];
-            std::swprintf (k, sizeof k / sizeof k [0], L"%08x", key);
+    const auto temporary = path + L"~";
 
-            file f;
-            if (f.create (path + k)) {
-                for (const auto & iid : iids) {
-                    f.write (iid);
-                }
-                this->changed.erase (key);
+    header h;
+    std::memcpy (h.magic, noticed_magic, sizeof h.magic);
+    h.version = noticed_version;
+    h.count = (std::uint32_t) this->total;
+
+    file f;
+    bool success = f.create (temporary, file::buffer::sequential)
+                && f.write (h);
+
+    // buckets are written whole, slots in ring order keep the file roughly sorted by time
+
+    std::vector <eid> ids;
+    for (auto b = this->ring.begin (), e = this->ring.end (); success && (b != e); ++b) {
+        ids.clear ();
+        for (const auto & id : b->slots) {
+            if (!null (id)) {
+                ids.push_back (id);
             }
         }
+        success = ids.empty ()
+               || f.write (ids.data (), ids.size () * sizeof (eid));
+    }
+    f.close ();
+
+    if (success && MoveFileEx (temporary.c_str (), path.c_str (), MOVEFILE_REPLACE_EXISTING)) {
+        this->changed = false;
+        return true;
+    } else {
+        raddi::log::error (component::database, 22, path);
+        DeleteFile (temporary.c_str ());
+        return false;
     }
 }
@@ -3,25 +3,45 @@
 
 #include "../common/lock.h"
 #include "raddi_eid.h"
-#include <set>
-#include <map>
+#include <deque>
+#include <vector>
 
 namespace raddi {
 
     // noticed
     //  - special cache for entry IDs optimized for cleaning by age
-    //  - TODO: evaluate gains of replacing 'set' with sorted vector
+    //  - ring of time buckets, sorted, each bucket is open-addressing hash set of EIDs
+    //    created within 'span' seconds
+    //     - lookup finds the bucket (typically the newest one) and probes linearly, no allocations
+    //     - 'clean' drops whole expired buckets from the front, filters only the boundary one
+    //  - persisted as single file, see 'save'
     //
     class noticed {
-        mutable ::lock                                  lock;
-        std::map <std::uint32_t, std::set <raddi::iid>> data;
-        mutable std::set <std::uint32_t>                changed; // changed since last successful save
+        mutable ::lock lock;
+
+        // bucket
+        //  - 'slots' size is power of two, kept at most half full, empty slot is null EID
+        //
+        struct bucket {
+            std::uint32_t     key = 0; // timestamp / span
+            std::uint32_t     count = 0;
+            std::vector <eid> slots;
+        };
+
+        std::deque <bucket> ring; // sorted by 'key'
+        std::size_t         total = 0;
+        mutable bool        changed = false; // since last successful save
+
+        // span
+        //  - seconds of entry timestamps covered by single bucket
+        //
+        static constexpr std::uint32_t span = 64;
 
     public:
 
         // insert
         //  - adds EID to noticed cache
-        //  - returns true if successfully inserted, false if already present
+        //  - returns true if successfully inserted, false if already present (or null EID)
         //
         bool insert (const eid & id);
 
@@ -42,12 +62,32 @@ namespace raddi {
 
         // load/save
         //  - loads or saves data to file at 'path'
+        //  - file is header followed by all EIDs, written to temporary file first and then replaced
+        //  - if the file doesn't exist, 'legacy' directory of per-timestamp files (previous format)
+        //    is loaded instead, converted to the file and removed
         //
-        bool load (const std::wstring & path);
-        void save (const std::wstring & path) const;
+        bool load (const std::wstring & path, const std::wstring & legacy = std::wstring ());
+        bool save (const std::wstring & path) const;
 
     private:
         static bool parse (const wchar_t * string, std::uint32_t * output);
+
+        static bool null (const eid & id) {
+            return id.timestamp == 0 && id.identity.timestamp == 0 && id.identity.nonce == 0;
+        }
+        static std::size_t hash (const eid & id) {
+            return eid::hash () (id);
+        }
+
+        const bucket * find (std::uint32_t key) const;
+        bucket & obtain (std::uint32_t key);
+
+        static bool probe (const bucket &, const eid & id);
+        static bool place (bucket &, const eid & id);
+        static void grow (bucket &);
+
+        bool unsynchronized_insert (const eid & id);
+        bool load_legacy (const std::wstring & directory, std::vector <std::wstring> & files);
     };
 }
 
@@ -6,11 +6,116 @@
 #include "../common/platform.h"
 #include "../common/threadpool.h"
 #include "../common/threadpool2.h"
+#include "../common/threadpool3.h"
 
 #include <memory>
 
 namespace {
 
+    // pool
+    //  - process-wide memory for solver buckets, kept across attempts and complexities,
+    //    grows to the largest one requested, so the gigabytes are not faulted in again for every entry
+    //  - backed by large pages when the process can lock memory (SeLockMemoryPrivilege),
+    //    otherwise regular pages are prefaulted once right after allocation
+    //  - used by single generation at a time, concurrent generations make solver allocate its own
+    //
+    class pool {
+        void *          memory = nullptr;
+        std::size_t     capacity = 0;
+        volatile long   busy = 0;
+        bool            large = false;
+
+    public:
+
+        // acquire
+        //  - on success sets parameters.memory/capacity to at least 'size' bytes
+        //  - must be paired with 'release'
+        //
+        bool acquire (cuckoo::parameters & parameters, std::size_t size) {
+            if (InterlockedExchange (&this->busy, 1) != 0)
+                return false;
+
+            if (this->capacity < size) {
+                this->free ();
+                this->allocate (size);
+            }
+            if (this->capacity >= size) {
+                parameters.memory = this->memory;
+                parameters.capacity = this->capacity;
+                return true;
+            } else {
+                InterlockedExchange (&this->busy, 0);
+                return false;
+            }
+        }
+        void release () {
+            InterlockedExchange (&this->busy, 0);
+        }
+
+        // trim
+        //  - frees the memory, unless currently in use
+        //
+        void trim () {
+            if (InterlockedExchange (&this->busy, 1) == 0) {
+                this->free ();
+                InterlockedExchange (&this->busy, 0);
+            }
+        }
+
+    private:
+        void allocate (std::size_t size) {
+            if (auto granularity = GetLargePageMinimum ()) {
+                if (EnableLockMemoryPrivilege ()) {
+                    const auto rounded = (size + granularity - 1) & ~(granularity - 1);
+                    if ((this->memory = VirtualAlloc (NULL, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE))) {
+                        this->capacity = rounded;
+                        this->large = true;
+                        return;
+                    }
+                }
+            }
+
+            if ((this->memory = VirtualAlloc (NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE))) {
+                this->capacity = size;
+                this->large = false;
+
+                // see cuckoo::solver::touch, large pages are resident already
+                if (sizeof (std::size_t) > sizeof (unsigned int)) {
+                    for (std::size_t i = 0; i < size; i += 4096) {
+                        static_cast <volatile std::uint8_t *> (this->memory) [i] = 0;
+                    }
+                }
+            }
+        }
+        void free () {
+            if (this->memory) {
+                VirtualFree (this->memory, 0, MEM_RELEASE);
+                this->memory = nullptr;
+                this->capacity = 0;
+            }
+        }
+
+        static bool EnableLockMemoryPrivilege () {
+            static const bool enabled = [] {
+                bool result = false;
+                HANDLE token;
+                if (OpenProcessToken (GetCurrentProcess (), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+                    TOKEN_PRIVILEGES privileges;
+                    privileges.PrivilegeCount = 1;
+                    privileges.Privileges [0].Attributes = SE_PRIVILEGE_ENABLED;
+
+                    if (LookupPrivilegeValue (NULL, SE_LOCK_MEMORY_NAME, &privileges.Privileges [0].Luid)) {
+                        result = AdjustTokenPrivileges (token, FALSE, &privileges, 0, NULL, NULL)
+                              && (GetLastError () == ERROR_SUCCESS);
+                    }
+                    CloseHandle (token);
+                }
+                return result;
+            } ();
+            return enabled;
+        }
+    } buckets;
+
     // generator_parent
     //  - to simplify syntax below and spell out underlying hash type only once
     //
@@ -113,6 +218,12 @@ namespace {
             options.parameters.longest = raddi::proof::max_length;
         }
 
+        if (options.complexity) {
+            *options.complexity = complexity;
+        }
+
+        const auto pooled = buckets.acquire (options.parameters, cuckoo::solver <complexity, generator>::bucket_memory);
+
         std::size_t length = 0;
         auto t0 = raddi::microtimestamp ();
 
@@ -131,6 +242,15 @@ namespace {
                 }
                 length = solve <cuckoo::solver <complexity, generator, threadpool2>> (hash, target, maximum, options.parameters);
                 break;
+
+            case raddi::proof::threadpool::portable:
+                threadpool3_base::affinity = options.affinity;
+                length = solve <cuckoo::solver <complexity, generator, threadpool3>> (hash, target, maximum, options.parameters);
+                break;
+        }
+
+        if (pooled) {
+            buckets.release ();
         }
 
         if (length) {
@@ -199,6 +319,10 @@ std::size_t raddi::proof::generate (const std::uint8_t (&hash) [crypto_hash_sha5
     }
 }
 
+void raddi::proof::trim () {
+    buckets.trim ();
+}
+
 std::size_t raddi::proof::generate (crypto_hash_sha512_state state, void * target, std::size_t maximum, options options) {
     std::uint8_t hash [crypto_hash_sha512_BYTES];
     if (crypto_hash_sha512_final (&state, hash) == 0)
@@ -131,6 +131,7 @@ namespace raddi {
             none,   // v0 "cuckoocycle.h" no threadpool
             system, // v1 "threapool.h" QueueUserWorkItem
             custom, // v2 "threapool2.h" spans groups, but has higher overhead
+            portable, // v3 "threadpool3.h" std::thread workers with work stealing
         };
 
         // options
@@ -140,6 +141,16 @@ namespace raddi {
             requirements        requirements;
             threadpool          threadpool = threadpool::automatic;
             cuckoo::parameters  parameters; // PoW generator parameters
+
+            // affinity
+            //  - pins workers of 'portable' threadpool to processors, see threadpool3_base::affinity
+            //
+            bool affinity = false;
+
+            // complexity
+            //  - optional, if set, 'generate' stores there complexity currently being attempted
+            //
+            volatile unsigned int * complexity = nullptr;
         };
 
     public:
@@ -164,6 +175,12 @@ namespace raddi {
         static std::size_t generate (crypto_hash_sha512_state, void * target, std::size_t maximum, options);
         static std::size_t generate (const std::uint8_t (&hash) [crypto_hash_sha512_BYTES], void * target, std::size_t maximum, options);
 
+        // trim
+        //  - frees memory that 'generate' keeps for reuse by subsequent calls
+        //  - for callers that don't expect to generate another proof soon
+        //
+        static void trim ();
+
         // static std::size_t generate_wide (const std::uint8_t (&hash) [crypto_hash_sha512_BYTES], void * target, std::size_t maximum,
         //                                  options, volatile bool * cancel = nullptr);
 
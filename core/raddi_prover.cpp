@@ -0,0 +1,191 @@
+#include "raddi_prover.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+raddi::prover::status raddi::prover::task::state () const {
+    std::unique_lock <std::mutex> guard (this->lock);
+    return this->current;
+}
+
+unsigned int raddi::prover::task::progress (float * fraction) const {
+    const auto complexity = this->complexity;
+    if (fraction) {
+        const auto total = cuckoo::rounds (complexity);
+        *fraction = std::min (1.0f, float (this->rounds) / float (total));
+    }
+    return complexity;
+}
+
+void raddi::prover::task::cancel () {
+    this->stop = true;
+}
+
+bool raddi::prover::task::wait (std::uint32_t timeout) const {
+    std::unique_lock <std::mutex> guard (this->lock);
+
+    const auto final = [this] {
+        return this->current != status::pending
+            && this->current != status::running;
+    };
+    if (timeout == (std::uint32_t) -1) {
+        this->signal.wait (guard, final);
+        return true;
+    } else
+        return this->signal.wait_for (guard, std::chrono::milliseconds (timeout), final);
+}
+
+std::size_t raddi::prover::task::result (void * target, std::size_t maximum) const {
+    std::unique_lock <std::mutex> guard (this->lock);
+    if ((this->current == status::done) && (this->size <= maximum)) {
+        std::memcpy (target, this->data, this->size);
+        return this->size;
+    } else
+        return 0;
+}
+
+raddi::prover::prover ()
+    : worker (&prover::thread, this) {}
+
+raddi::prover::~prover () {
+    {
+        std::unique_lock <std::mutex> guard (this->lock);
+        this->quit = true;
+
+        if (this->running) {
+            this->running->cancel ();
+        }
+    }
+    this->signal.notify_all ();
+    this->worker.join ();
+
+    for (auto & t : this->queue) {
+        finish (*t, status::cancelled);
+    }
+    proof::trim ();
+}
+
+bool raddi::prover::order (const std::shared_ptr <task> & a, const std::shared_ptr <task> & b) {
+    if (a->priority != b->priority)
+        return a->priority < b->priority;
+    else
+        return a->sequence > b->sequence;
+}
+
+std::shared_ptr <raddi::prover::task>
+raddi::prover::submit (const std::uint8_t (&hash) [crypto_hash_sha512_BYTES], proof::options options,
+                       int priority, std::function <void (task &)> callback) {
+    auto t = std::make_shared <task> ();
+
+    std::memcpy (t->hash, hash, sizeof hash);
+    t->options = options;
+    t->priority = priority;
+    t->callback = std::move (callback);
+
+    // task's own flags are used, caller cancels through the handle
+
+    t->options.parameters.cancel = &t->stop;
+    t->options.parameters.progress = &t->rounds;
+    t->options.complexity = &t->complexity;
+
+    {
+        std::unique_lock <std::mutex> guard (this->lock);
+        t->sequence = this->sequence++;
+
+        this->queue.push_back (t);
+        std::push_heap (this->queue.begin (), this->queue.end (), order);
+    }
+    this->signal.notify_one ();
+    return t;
+}
+
+std::shared_ptr <raddi::prover::task>
+raddi::prover::submit (crypto_hash_sha512_state state, proof::options options,
+                       int priority, std::function <void (task &)> callback) {
+    std::uint8_t hash [crypto_hash_sha512_BYTES];
+    crypto_hash_sha512_final (&state, hash);
+    return this->submit (hash, options, priority, std::move (callback));
+}
+
+std::size_t raddi::prover::pending () {
+    std::unique_lock <std::mutex> guard (this->lock);
+    return this->queue.size ();
+}
+
+void raddi::prover::finish (task & t, status s) {
+    {
+        std::unique_lock <std::mutex> guard (t.lock);
+        t.current = s;
+    }
+    t.signal.notify_all ();
+
+    if (t.callback) {
+        t.callback (t);
+    }
+}
+
+void raddi::prover::thread () {
+    bool generated = false;
+    while (true) {
+        std::shared_ptr <task> t;
+        {
+            std::unique_lock <std::mutex> guard (this->lock);
+            const auto ready = [this] { return this->quit || !this->queue.empty (); };
+
+            // idle for a while after generating, no more drafts are expected soon
+
+            if (generated) {
+                if (!this->signal.wait_for (guard, std::chrono::seconds (idle_period), ready)) {
+                    guard.unlock ();
+                    proof::trim ();
+                    generated = false;
+                    continue;
+                }
+            } else {
+                this->signal.wait (guard, ready);
+            }
+
+            if (this->quit)
+                return;
+
+            std::pop_heap (this->queue.begin (), this->queue.end (), order);
+            t = std::move (this->queue.back ());
+            this->queue.pop_back ();
+
+            // cancelled while pending, just discard
+
+            if (t->stop) {
+                guard.unlock ();
+                finish (*t, status::cancelled);
+                continue;
+            }
+            this->running = t;
+        }
+
+        {
+            std::unique_lock <std::mutex> guard (t->lock);
+            t->current = status::running;
+        }
+
+        auto s = status::failed;
+        try {
+            if (auto n = proof::generate (t->hash, t->data, sizeof t->data, t->options)) {
+                t->size = n;
+                s = status::done;
+            } else
+            if (t->stop) {
+                s = status::cancelled;
+            }
+        } catch (const std::bad_alloc &) {
+            s = t->stop ? status::cancelled : status::failed;
+        }
+
+        {
+            std::unique_lock <std::mutex> guard (this->lock);
+            this->running.reset ();
+        }
+        finish (*t, s);
+        generated = true;
+    }
+}
@@ -0,0 +1,130 @@
+#ifndef RADDI_PROVER_H
+#define RADDI_PROVER_H
+
+#include "raddi_proof.h"
+
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+namespace raddi {
+
+    // prover
+    //  - asynchronous, cancellable proof-of-work generation service
+    //  - submitted requests wait in priority queue, single worker generates one proof at a time
+    //    with full solver parallelism, so all pending entries share one solver threadpool and bucket memory
+    //  - intended for precomputing proofs of drafts: submit early, cancel cheaply when the draft changes
+    //  - solver memory (see proof::trim) is released after 'idle_period' seconds without requests
+    //
+    class prover {
+    public:
+
+        // status
+        //  - lifecycle of a task; 'done', 'failed' and 'cancelled' are final
+        //
+        enum class status {
+            pending,
+            running,
+            done,
+            failed,     // no proof found under requirements, or not enough memory
+            cancelled,
+        };
+
+        // task
+        //  - handle to single submitted request, shared by the caller and the service
+        //
+        class task {
+            friend class prover;
+
+            mutable std::mutex              lock;
+            mutable std::condition_variable signal;
+            prover::status                  current = status::pending;
+
+            std::uint8_t                    hash [crypto_hash_sha512_BYTES];
+            proof::options                  options;
+            int                             priority;
+            std::uint64_t                   sequence;
+            std::function <void (task &)>   callback;
+
+            volatile bool                   stop = false;
+            volatile unsigned int           complexity = 0;
+            volatile std::uint32_t          rounds = 0;
+
+            std::uint8_t                    data [proof::max_size];
+            std::size_t                     size = 0;
+
+        public:
+
+            // state
+            //  - returns current status of the task
+            //
+            prover::status state () const;
+
+            // progress
+            //  - returns complexity currently attempted (0 if not started yet)
+            //    and fraction (0..1) of trimming rounds completed for it
+            //
+            unsigned int progress (float * fraction = nullptr) const;
+
+            // cancel
+            //  - pending task is dropped, running one stops at next trimming round boundary
+            //
+            void cancel ();
+
+            // wait
+            //  - blocks until the task reaches final state or 'timeout' (ms) elapses
+            //  - returns true if the task is final
+            //
+            bool wait (std::uint32_t timeout = (std::uint32_t) -1) const;
+
+            // result
+            //  - copies found proof to 'target' (up to 'maximum' bytes)
+            //  - returns size of the proof, or 0 if the task is not 'done' or 'target' is too small
+            //
+            std::size_t result (void * target, std::size_t maximum) const;
+        };
+
+    private:
+        std::mutex                              lock;
+        std::condition_variable                 signal;
+        std::vector <std::shared_ptr <task>>    queue; // binary heap, see 'order'
+        std::shared_ptr <task>                  running;
+        std::uint64_t                           sequence = 0;
+        bool                                    quit = false;
+        std::thread                             worker;
+
+    public:
+        static constexpr unsigned int idle_period = 60;
+
+    public:
+        prover ();
+        ~prover ();
+
+        // submit
+        //  - queues proof-of-work generation for 'hash' (see proof::generate)
+        //  - higher 'priority' goes first, same priority in order of submission
+        //  - 'callback' is optional, invoked when the task reaches final state, from the worker thread
+        //    or, for tasks still pending when the prover is destroyed, from the destructor
+        //  - throws std::bad_alloc
+        //
+        std::shared_ptr <task> submit (const std::uint8_t (&hash) [crypto_hash_sha512_BYTES], proof::options options,
+                                       int priority = 0, std::function <void (task &)> callback = nullptr);
+        std::shared_ptr <task> submit (crypto_hash_sha512_state state, proof::options options,
+                                       int priority = 0, std::function <void (task &)> callback = nullptr);
+
+        // pending
+        //  - returns number of tasks waiting in the queue (including cancelled but not yet discarded)
+        //
+        std::size_t pending ();
+
+    private:
+        void thread ();
+        static bool order (const std::shared_ptr <task> & a, const std::shared_ptr <task> & b);
+        static void finish (task & t, status s);
+    };
+}
+
+#endif
@@ -3,23 +3,40 @@
 
 void raddi::subscription_set::subscribe (const uuid & app, const eid & subscription) {
     exclusive guard (this->lock);
-    this->data [app].subscribe (subscription);
+    if (this->data [app].subscribe (subscription)) {
+        this->unsynchronized_merge (subscription);
+    }
 }
 
 bool raddi::subscription_set::unsubscribe (const uuid & app, const eid & subscription) {
     exclusive guard (this->lock);
     try {
-        return this->data.at (app).unsubscribe (subscription);
+        if (this->data.at (app).unsubscribe (subscription)) {
+
+            auto i = this->merged.find (subscription);
+            if (i != this->merged.end ()) {
+                if (--i->second == 0) {
+                    this->merged.erase (i);
+                }
+            }
+            return true;
+        } else
+            return false;
+
     } catch (const std::out_of_range &) {
         // not such 'app'
         return false;
     }
 }
 
+void raddi::subscription_set::unsynchronized_merge (const eid & subscription) {
+    ++this->merged [subscription];
+}
+
 bool raddi::subscription_set::is_subscribed (const eid * begin, const eid * end) const {
     immutability guard (this->lock);
-    for (const auto & subs : this->data) {
-        if (subs.second.is_subscribed (begin, end))
+    for (auto i = begin; i != end; ++i) {
+        if (this->merged.count (*i))
             return true;
     }
     return false;
@@ -54,8 +71,16 @@ bool raddi::subscription_set::load () {
                         raddi::log::error (component::database, 25, full);
                     }
                 };
-                return directory ((this->path + L"*").c_str ()) (callback) 
-                    || raddi::log::error (component::database, 22, this->path);
+                auto result = directory ((this->path + L"*").c_str ()) (callback)
+                           || raddi::log::error (component::database, 22, this->path);
+
+                this->merged.clear ();
+                for (const auto & subs : this->data) {
+                    subs.second.enumerate ([this] (const eid & subscription) {
+                        this->unsynchronized_merge (subscription);
+                    });
+                }
+                return result;
 
             } catch (const std::bad_alloc &) {
                 raddi::log::error (component::database, 21);
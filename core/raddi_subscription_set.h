@@ -6,6 +6,7 @@
 #include "raddi_subscriptions.h"
 #include <string>
 #include <map>
+#include <unordered_map>
 
 namespace raddi {
 
@@ -13,8 +14,6 @@ namespace raddi {
     //  - keeps lists of channel/thread EIDs for each client application
     //     - used to store/check both subscriptions and blacklist
     //  - note that for logging purposes this is part of "database" component
-    //  - NOTE: this could be optimized further by keeping std::set<raddi::eid> cache
-    //          and searching only that one in 'is_subscribed'
     //
     class subscription_set
         : log::provider <component::database> {
@@ -23,6 +22,13 @@ namespace raddi {
         std::map <uuid, subscriptions>  data;
         const std::wstring              path;
 
+        // merged
+        //  - all EIDs of all apps, with number of app lists that hold them
+        //  - kept in sync by 'subscribe' and 'unsubscribe', rebuilt on 'load'
+        //  - 'is_subscribed' checks only this, instead of iterating every app
+        //
+        std::unordered_map <eid, std::size_t, eid::hash> merged;
+
     public:
         subscription_set (const std::wstring & dbpath, const std::wstring & name)
             : provider ("set", name)
@@ -37,6 +43,7 @@ namespace raddi {
 
         // is_subscribed
         //  - returns true if any of the app subscriptions contain one of EIDs
+        //  - single hash lookup per EID, regardless of number of apps
         //
         bool is_subscribed (const eid * begin, const eid * end) const;
 
@@ -47,15 +54,13 @@ namespace raddi {
 
         // enumerate
         //  - calls 'callback' with every EID in the set
-        //  - used mainly by 'leaf' nodes which tend to have single 'app'
-        //    so we probably don't need to take care to remove duplicities
-        //    (for now)
+        //  - EIDs subscribed by multiple apps are reported only once
         //
         template <typename F>
         void enumerate (F callback) const {
             immutability guard (this->lock);
-            for (const auto & subs : this->data) {
-                subs.second.enumerate (callback);
+            for (const auto & m : this->merged) {
+                callback (m.first);
             }
         }
 
@@ -68,6 +73,9 @@ namespace raddi {
         //  - saves all subscriptions that has changed
         //
         void flush () const;
+
+    private:
+        void unsynchronized_merge (const eid &);
     };
 }
 
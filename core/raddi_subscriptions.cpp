@@ -2,7 +2,7 @@
 #include "../common/file.h"
 #include <algorithm>
 
-void raddi::subscriptions::subscribe (const eid & subscription, std::size_t max_individual_subscriptions) {
+bool raddi::subscriptions::subscribe (const eid & subscription, std::size_t max_individual_subscriptions) {
     exclusive guard (this->lock);
 
     if (this->everything == false) {
@@ -13,12 +13,14 @@ void raddi::subscriptions::subscribe (const eid & subscription, std::size_t max_
             }
             this->data.insert (std::lower_bound (this->data.begin (), this->data.end (), subscription), subscription);
             this->changed = true;
+            return true;
         } else {
             this->subscribe_to_everything_unsynchronized ();
         }
     }
 
     // TODO: stream support: stream EIDs need to be added always, if still congested, simply delete oldest
+    return false;
 }
 
 bool raddi::subscriptions::unsubscribe (const eid & subscription) {
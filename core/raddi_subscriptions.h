@@ -25,8 +25,9 @@ namespace raddi {
         // (un)subscribe(to_everything(_unsynchronized))
         //  - maintains storage of subscriptions honoring limits (to avoid DoS by malicious peer)
         //  - for connections it is called by coordinator after it processes raddi::request frames
+        //  - 'subscribe' returns true if the EID was added to the individual list
         //
-        void subscribe (const eid &, std::size_t max_individual_subscriptions = (std::size_t) -1);
+        bool subscribe (const eid &, std::size_t max_individual_subscriptions = (std::size_t) -1);
         void subscribe_to_everything ();
         bool unsubscribe (const eid &); // returns true if removed
 
@@ -14,10 +14,16 @@
 //  - TODO: combine common parts of trimXxxx functions
 //  - TODO: move common operations to indexer
 //  - TODO: make solver->base /buckets class with 'write<N>' function
-//  - TODO: use libsimdpp for SipHash and other
 //
 namespace cuckoo {
 
+    // rounds
+    //  - number of edge trimming rounds the solver performs for given complexity, see solver::rounds
+    //
+    constexpr std::uint32_t rounds (unsigned int complexity) {
+        return (complexity > 30) ? 96u : 68u;
+    }
+
     // singlethreaded
     //  - fallback thread pool controller; single-threaded serial
     //
@@ -53,8 +59,10 @@ namespace cuckoo {
 
         // parallelism
         //  - defines how many hashes does parallel operator() compute at once
+        //  - the batch is computed by widest SIMD implementation available at runtime
+        //    (AVX-512: 8 lanes, AVX2: 4 lanes, SSE2 and NEON: 2 lanes), or by scalar code
         //
-        static constexpr auto parallelism = 1u;
+        static constexpr auto parallelism = 8u;
 
         // seed
         //  - initialization function
@@ -70,13 +78,9 @@ namespace cuckoo {
 
         // operator ()
         //  - generates full parallelism-sized batch of outputs per input(s)
+        //  - output is bit-identical to calling operator()(type) for each input
         //
-        inline void operator () (type (&output) [parallelism], const type (&input) [parallelism]) const {
-            // TODO: implement SSE2/AVX version, see 'cuckoo\src\crypto\siphashxN.h'
-            for (std::size_t i = 0u; i != this->parallelism; ++i) {
-                output [i] = this->operator () (input [i]);
-            }
-        }
+        inline void operator () (type (&output) [parallelism], const type (&input) [parallelism]) const;
 
         // operator (const void *, std::size_t)
         //  - hashes a buffer of data
@@ -88,10 +92,22 @@ namespace cuckoo {
     private:
         static inline std::uint64_t rotl64 (const std::uint64_t x, const int b);
         static inline void round (std::uint64_t (&v) [4]);
+
+        // batch
+        //  - implementations of the parallel operator(), Isa is one of 'simd' lane traits, see .tcc
+        //  - 'select' picks the widest one supported by the CPU, once per process
+        //
+        typedef void (* batch_function) (const std::uint64_t (&base) [4], type * output, const type * input);
+
+        template <typename Isa>
+        static inline void batch (const std::uint64_t (&base) [4], type * output, const type * input);
+        template <typename Isa>
+        static inline void round (typename Isa::vector (&v) [4]);
+        static inline batch_function select ();
     };
 
     // verify
-    //  - Generator - edges hashing functor; verification does not use parallel generation
+    //  - Generator - edges hashing functor; endpoints are hashed in parallel batches
     //  - complexity/seed
     //     - must be the same used to find solution, to successfully verify it
     //  - cycle/length - solution to verify
@@ -125,6 +141,18 @@ namespace cuckoo {
         //  - 0 means autodetect maximum
         //
         unsigned int parallelism = 0;
+
+        // memory/capacity
+        //  - optional caller-provided memory for solver's buckets, used if 'capacity' is at least solver::bucket_memory
+        //  - solver then neither allocates, prefaults nor frees the buckets, contents need not be initialized
+        //
+        void *      memory = nullptr;
+        std::size_t capacity = 0;
+
+        // progress
+        //  - optional, if set, solver stores there number of trimming rounds finished, out of solver::rounds
+        //
+        volatile std::uint32_t * progress = nullptr;
     };
 
     // solver
@@ -301,7 +329,9 @@ namespace cuckoo {
     public:
         explicit solver (parameters p)
             : parameters (p)
-            , buckets (new yzbucket <ZBUCKETSIZE> [NX]) {
+            , buckets ((p.memory && p.capacity >= sizeof (yzbucket <ZBUCKETSIZE>) * NX)
+                        ? static_cast <yzbucket <ZBUCKETSIZE> *> (p.memory)
+                        : new yzbucket <ZBUCKETSIZE> [NX]) {
 
             if (this->shortest == 0) {
                 this->shortest = 4;
@@ -315,16 +345,22 @@ namespace cuckoo {
             try {
                 this->work.resize (this->parallelism);
             } catch (const std::bad_alloc &) {
-                delete [] this->buckets;
+                if (!this->external ()) {
+                    delete [] this->buckets;
+                }
             }
         };
         ~solver () {
-            delete [] this->buckets;
+            if (!this->external ()) {
+                delete [] this->buckets;
+            }
         }
 
     public:
         static constexpr auto               complexity = Complexity;
         static constexpr auto               suggested_parallelism = NY;
+        static constexpr std::size_t        bucket_memory = sizeof (yzbucket <ZBUCKETSIZE>) * NX;
+        static constexpr std::uint32_t      rounds = cuckoo::rounds (Complexity);
         typedef Generator                   generator_type;
         typedef ThreadPoolControl <fiber>   threadpool_type;
 
@@ -332,6 +368,8 @@ namespace cuckoo {
         std::uint32_t path (std::uint32_t * cycle, std::uint32_t u, std::uint32_t * us) const;
         void recordedge (unsigned int i, unsigned int u2, unsigned int v2);
         inline bool cancelled () const { return this->cancel && *this->cancel; }
+        inline bool external () const { return this->base == this->memory; }
+        inline void report (std::uint32_t n) const { if (this->progress) *this->progress = n; }
 
         // touch
         //  - attempts to bring all commited pages into working set for improved performance
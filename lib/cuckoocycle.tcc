@@ -3,6 +3,181 @@
 
 #include "cuckoocycle.h"
 
+#if defined (_M_X64) || defined (_M_AMD64) || defined (__x86_64__) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2) || defined (__SSE2__)
+#define CUCKOO_SIMD_SSE2
+#if defined (_MSC_VER) || defined (__AVX2__)
+#define CUCKOO_SIMD_AVX2
+#endif
+#if defined (_MSC_VER) || defined (__AVX512F__)
+#define CUCKOO_SIMD_AVX512
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+#if defined (_M_ARM64) || defined (__ARM_NEON)
+#define CUCKOO_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+// simd
+//  - lane traits for cuckoo::hash::batch, each provides 'vector' type holding 'lanes' 64-bit values
+//    and basic operations on it, the SipHash round itself is written once in 'hash::round <Isa>'
+//  - MSVC allows AVX2/AVX-512 intrinsics without /arch switch, other compilers
+//    only get what they are allowed to generate for the whole translation unit
+//
+namespace cuckoo {
+namespace simd {
+
+    struct scalar {
+        typedef std::uint64_t vector;
+        static constexpr auto lanes = 1u;
+
+        static inline vector load (const std::uint64_t * p) { return *p; }
+        static inline void store (std::uint64_t * p, vector v) { *p = v; }
+        static inline vector set (std::uint64_t x) { return x; }
+        static inline vector add (vector a, vector b) { return a + b; }
+        static inline vector xor_ (vector a, vector b) { return a ^ b; }
+
+        template <int B>
+        static inline vector rotl (vector x) { return (x << B) | (x >> (64 - B)); }
+    };
+
+#ifdef CUCKOO_SIMD_SSE2
+    struct sse2 {
+        typedef __m128i vector;
+        static constexpr auto lanes = 2u;
+
+        static inline vector load (const std::uint64_t * p) { return _mm_loadu_si128 (reinterpret_cast <const __m128i *> (p)); }
+        static inline void store (std::uint64_t * p, vector v) { _mm_storeu_si128 (reinterpret_cast <__m128i *> (p), v); }
+        static inline vector set (std::uint64_t x) { return _mm_set1_epi64x ((long long) x); }
+        static inline vector add (vector a, vector b) { return _mm_add_epi64 (a, b); }
+        static inline vector xor_ (vector a, vector b) { return _mm_xor_si128 (a, b); }
+
+        template <int B>
+        static inline vector rotl (vector x) {
+            if constexpr (B == 32)
+                return _mm_shuffle_epi32 (x, _MM_SHUFFLE (2, 3, 0, 1));
+            else
+            if constexpr (B == 16)
+                return _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (x, _MM_SHUFFLE (2, 1, 0, 3)), _MM_SHUFFLE (2, 1, 0, 3));
+            else
+                return _mm_or_si128 (_mm_slli_epi64 (x, B), _mm_srli_epi64 (x, 64 - B));
+        }
+    };
+#endif
+
+#ifdef CUCKOO_SIMD_AVX2
+    struct avx2 {
+        typedef __m256i vector;
+        static constexpr auto lanes = 4u;
+
+        static inline vector load (const std::uint64_t * p) { return _mm256_loadu_si256 (reinterpret_cast <const __m256i *> (p)); }
+        static inline void store (std::uint64_t * p, vector v) { _mm256_storeu_si256 (reinterpret_cast <__m256i *> (p), v); }
+        static inline vector set (std::uint64_t x) { return _mm256_set1_epi64x ((long long) x); }
+        static inline vector add (vector a, vector b) { return _mm256_add_epi64 (a, b); }
+        static inline vector xor_ (vector a, vector b) { return _mm256_xor_si256 (a, b); }
+
+        template <int B>
+        static inline vector rotl (vector x) {
+            if constexpr (B == 32)
+                return _mm256_shuffle_epi32 (x, _MM_SHUFFLE (2, 3, 0, 1));
+            else
+            if constexpr (B == 16)
+                return _mm256_shuffle_epi8 (x, _mm256_set_epi64x (0x0D0C'0B0A'0908'0F0E, 0x0504'0302'0100'0706,
+                                                                   0x0D0C'0B0A'0908'0F0E, 0x0504'0302'0100'0706));
+            else
+                return _mm256_or_si256 (_mm256_slli_epi64 (x, B), _mm256_srli_epi64 (x, 64 - B));
+        }
+    };
+#endif
+
+#ifdef CUCKOO_SIMD_AVX512
+    struct avx512 {
+        typedef __m512i vector;
+        static constexpr auto lanes = 8u;
+
+        static inline vector load (const std::uint64_t * p) { return _mm512_loadu_si512 (p); }
+        static inline void store (std::uint64_t * p, vector v) { _mm512_storeu_si512 (p, v); }
+        static inline vector set (std::uint64_t x) { return _mm512_set1_epi64 ((long long) x); }
+        static inline vector add (vector a, vector b) { return _mm512_add_epi64 (a, b); }
+        static inline vector xor_ (vector a, vector b) { return _mm512_xor_si512 (a, b); }
+
+        template <int B>
+        static inline vector rotl (vector x) { return _mm512_rol_epi64 (x, B); }
+    };
+#endif
+
+#ifdef CUCKOO_SIMD_NEON
+    struct neon {
+        typedef uint64x2_t vector;
+        static constexpr auto lanes = 2u;
+
+        static inline vector load (const std::uint64_t * p) { return vld1q_u64 (p); }
+        static inline void store (std::uint64_t * p, vector v) { vst1q_u64 (p, v); }
+        static inline vector set (std::uint64_t x) { return vdupq_n_u64 (x); }
+        static inline vector add (vector a, vector b) { return vaddq_u64 (a, b); }
+        static inline vector xor_ (vector a, vector b) { return veorq_u64 (a, b); }
+
+        template <int B>
+        static inline vector rotl (vector x) {
+            if constexpr (B == 32)
+                return vreinterpretq_u64_u32 (vrev64q_u32 (vreinterpretq_u32_u64 (x)));
+            else
+                return vsliq_n_u64 (vshrq_n_u64 (x, 64 - B), x, B);
+        }
+    };
+#endif
+
+    // support
+    //  - runtime detection of wider x86 instruction sets, including OS support for the registers
+    //
+    enum class support {
+        baseline,
+        avx2,
+        avx512,
+    };
+
+    inline support detect () {
+#if defined (CUCKOO_SIMD_SSE2) && defined (_MSC_VER)
+        int r [4];
+        __cpuid (r, 0);
+        if (r [0] < 7)
+            return support::baseline;
+
+        __cpuid (r, 1);
+        if (!(r [2] & (1 << 27))) // OSXSAVE
+            return support::baseline;
+
+        const auto xcr0 = _xgetbv (0);
+        __cpuidex (r, 7, 0);
+
+        if (((xcr0 & 0xE6) == 0xE6) && (r [1] & (1 << 16))) // ZMM/opmask state, AVX512F
+            return support::avx512;
+        if (((xcr0 & 0x06) == 0x06) && (r [1] & (1 << 5))) // YMM state, AVX2
+            return support::avx2;
+
+        return support::baseline;
+
+#elif defined (CUCKOO_SIMD_SSE2) && defined (__GNUC__)
+        __builtin_cpu_init ();
+#ifdef CUCKOO_SIMD_AVX512
+        if (__builtin_cpu_supports ("avx512f"))
+            return support::avx512;
+#endif
+#ifdef CUCKOO_SIMD_AVX2
+        if (__builtin_cpu_supports ("avx2"))
+            return support::avx2;
+#endif
+        return support::baseline;
+#else
+        return support::baseline;
+#endif
+    }
+}
+}
+
 // hash
 
 template <unsigned N1, unsigned N2>
@@ -120,6 +295,88 @@ inline typename cuckoo::hash <N1, N2> ::type cuckoo::hash <N1, N2> ::operator ()
     return (v [0] ^ v [1]) ^ (v [2] ^ v [3]);
 }
 
+template <unsigned N1, unsigned N2>
+template <typename Isa>
+inline void cuckoo::hash <N1, N2> ::round (typename Isa::vector (&v) [4]) {
+    v [0] = Isa::add (v [0], v [1]);
+    v [1] = Isa::template rotl <13> (v [1]);
+    v [1] = Isa::xor_ (v [1], v [0]);
+    v [0] = Isa::template rotl <32> (v [0]);
+    v [2] = Isa::add (v [2], v [3]);
+    v [3] = Isa::template rotl <16> (v [3]);
+    v [3] = Isa::xor_ (v [3], v [2]);
+    v [0] = Isa::add (v [0], v [3]);
+    v [3] = Isa::template rotl <21> (v [3]);
+    v [3] = Isa::xor_ (v [3], v [0]);
+    v [2] = Isa::add (v [2], v [1]);
+    v [1] = Isa::template rotl <17> (v [1]);
+    v [1] = Isa::xor_ (v [1], v [2]);
+    v [2] = Isa::template rotl <32> (v [2]);
+}
+
+template <unsigned N1, unsigned N2>
+template <typename Isa>
+inline void cuckoo::hash <N1, N2> ::batch (const std::uint64_t (&base) [4], type * output, const type * input) {
+    static_assert (parallelism % Isa::lanes == 0, "batch must be multiple of lanes");
+
+    for (auto j = 0u; j != parallelism; j += Isa::lanes) {
+        const auto in = Isa::load (input + j);
+
+        typename Isa::vector v [4] = {
+            Isa::set (base [0]),
+            Isa::set (base [1]),
+            Isa::set (base [2]),
+            Isa::set (base [3]),
+        };
+        if (!N1) {
+            v [1] = Isa::xor_ (v [1], in);
+        }
+        if (N2) {
+            v [3] = Isa::xor_ (v [3], in);
+        }
+
+        for (auto i = 0u; i != N1; ++i) {
+            round <Isa> (v);
+        }
+        if (N1 && N2) {
+            v [0] = Isa::xor_ (v [0], in);
+            v [2] = Isa::xor_ (v [2], Isa::set (0xff));
+        }
+        for (auto i = 0u; i != N2; ++i) {
+            round <Isa> (v);
+        }
+        Isa::store (output + j, Isa::xor_ (Isa::xor_ (v [0], v [1]), Isa::xor_ (v [2], v [3])));
+    }
+}
+
+template <unsigned N1, unsigned N2>
+inline typename cuckoo::hash <N1, N2> ::batch_function cuckoo::hash <N1, N2> ::select () {
+#if defined (CUCKOO_SIMD_SSE2)
+    switch (simd::detect ()) {
+#ifdef CUCKOO_SIMD_AVX512
+        case simd::support::avx512:
+            return &hash::batch <simd::avx512>;
+#endif
+#ifdef CUCKOO_SIMD_AVX2
+        case simd::support::avx2:
+            return &hash::batch <simd::avx2>;
+#endif
+        default:
+            return &hash::batch <simd::sse2>;
+    }
+#elif defined (CUCKOO_SIMD_NEON)
+    return &hash::batch <simd::neon>;
+#else
+    return &hash::batch <simd::scalar>;
+#endif
+}
+
+template <unsigned N1, unsigned N2>
+inline void cuckoo::hash <N1, N2> ::operator () (type (&output) [parallelism], const type (&input) [parallelism]) const {
+    static const auto implementation = select ();
+    implementation (this->base, output, input);
+}
+
 // indexer
 
 template <unsigned Complexity, typename Generator, template <typename> class ThreadPoolControl>
@@ -184,13 +441,16 @@ std::size_t cuckoo::solver <Complexity, Generator, ThreadPoolControl> ::solve (c
     // actually preallocate the memory for faster performance
     //  - as I expect 32-bit build will be used only on slow/small devices which may not have 4 GB RAM,
     //    I don't do this as it would actually degrade performance by introducting extensive swapping
+    //  - caller-provided memory is caller's responsibility
 
-    if (sizeof (std::size_t) > sizeof (unsigned int)) {
+    if ((sizeof (std::size_t) > sizeof (unsigned int)) && !this->external ()) {
         this->touch (this->buckets, sizeof (zbucket<ZBUCKETSIZE>) * NY * NX, this->cancel);
     }
 
     // trim
 
+    this->report (0);
+
     if (!this->cancelled ()) {
         this->threadpool.begin ();
             for (auto & t : this->work) this->threadpool.dispatch (&fiber::genUnodes, &t, true);
@@ -200,7 +460,8 @@ std::size_t cuckoo::solver <Complexity, Generator, ThreadPoolControl> ::solve (c
         this->threadpool.join ();
 
         this->round = 2;
-        for (; (this->round != ((Complexity > 30) ? 96u : 68u) - 2) && !this->cancelled (); this->round += 2) {
+        for (; (this->round != rounds - 2) && !this->cancelled (); this->round += 2) {
+            this->report (this->round);
             this->threadpool.begin ();
                 for (auto & t : this->work) this->threadpool.dispatch (&fiber::template trimRound <true>, &t, true);
             this->threadpool.join ();
@@ -209,12 +470,14 @@ std::size_t cuckoo::solver <Complexity, Generator, ThreadPoolControl> ::solve (c
             this->threadpool.join ();
         }
 
+        this->report (this->round);
         this->threadpool.begin ();
             for (auto & t : this->work) this->threadpool.dispatch (&fiber::template trimRename1 <true>, &t, true);
         this->threadpool.join ();
         this->threadpool.begin ();
             for (auto & t : this->work) this->threadpool.dispatch (&fiber::template trimRename1 <false>, &t, true);
         this->threadpool.join ();
+        this->report (rounds);
     }
 
     // solution recovery
@@ -911,6 +1174,11 @@ template <typename Generator>
 bool cuckoo::verify (unsigned complexity,
                      const std::uint8_t (&seed) [Generator::width],
                      const std::uintmax_t * cycle, std::size_t length) {
+    // graph is bipartite, every cycle has even number of edges
+
+    if ((length == 0) || (length % 2))
+        return false;
+
     Generator generator;
     generator.seed (seed);
 
@@ -921,30 +1189,76 @@ bool cuckoo::verify (unsigned complexity,
     for (std::size_t n = 0; n != length; ++n) {
         if (cycle [n] >= (1uLL << complexity)) return false; // too large node
         if (n && cycle [n] <= cycle [n - 1]) return false; // not sorted
+    }
+
+    // both endpoints of all edges, hashed in generator-sized batches
+    //  - uvs [m] = hash (2 * cycle [m / 2] + m % 2), last batch is padded with zeroes
+
+    for (std::size_t m = 0; m < 2 * length; m += Generator::parallelism) {
+        typename Generator::type node [Generator::parallelism];
+        typename Generator::type source [Generator::parallelism];
+
+        for (auto i = 0u; i != Generator::parallelism; ++i) {
+            source [i] = (m + i < 2 * length) ? (2 * cycle [(m + i) / 2] + (m + i) % 2) : 0;
+        }
+
+        generator (node, source);
 
-        xor0 ^= uvs [2 * n + 0] = ((1uLL << complexity) - 1u) & generator (2 * cycle [n] + 0);
-        xor1 ^= uvs [2 * n + 1] = ((1uLL << complexity) - 1u) & generator (2 * cycle [n] + 1);
+        for (auto i = 0u; (i != Generator::parallelism) && (m + i < 2 * length); ++i) {
+            uvs [m + i] = ((1uLL << complexity) - 1u) & node [i];
+            if ((m + i) % 2) {
+                xor1 ^= uvs [m + i];
+            } else {
+                xor0 ^= uvs [m + i];
+            }
+        }
     }
     if (xor0 | xor1)
         return false;
 
-    auto n = 0u;
-    auto i = 0u;
-    auto j = 0u;
-    do {
-        for (auto k = j = i; (k = (k + 2) % (2 * length)) != i; ) {
-            if (uvs [k] == uvs [i]) {
-                if (j != i)
-                    return false;
+    // partner
+    //  - for every endpoint the other endpoint of the same side (parity) sharing its node,
+    //    or 'none' if the node is not shared by exactly two edges
+    //  - found by sorting endpoints by side and node once, O(n log n)
 
-                j = k;
-            }
+    static constexpr auto none = ~std::size_t (0);
+
+    std::vector <std::size_t> order (2 * length);
+    std::vector <std::size_t> partner (2 * length, none);
+
+    for (std::size_t k = 0; k != order.size (); ++k) {
+        order [k] = k;
+    }
+    std::sort (order.begin (), order.end (), [&uvs] (std::size_t a, std::size_t b) {
+        return ((a % 2) < (b % 2))
+            || (((a % 2) == (b % 2)) && (uvs [a] < uvs [b]));
+    });
+
+    for (std::size_t k = 0; k != order.size (); ) {
+        auto e = k + 1;
+        while ((e != order.size ()) && ((order [e] % 2) == (order [k] % 2)) && (uvs [order [e]] == uvs [order [k]])) {
+            ++e;
+        }
+        if (e - k == 2) {
+            partner [order [k]] = order [k + 1];
+            partner [order [k + 1]] = order [k];
         }
-        if (j == i)
+        k = e;
+    }
+
+    // walk the cycle
+    //  - alternating between U and V sides, must return to the first edge after exactly 'length' steps
+
+    std::size_t n = 0;
+    std::size_t i = 0;
+    do {
+        if (partner [i] == none)
+            return false;
+
+        i = partner [i] ^ 1;
+        if (++n > length)
             return false;
 
-        i = j ^ 1;
-        ++n;
     } while (i != 0);
 
     return n == length;
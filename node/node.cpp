@@ -71,7 +71,7 @@ namespace {
     };
     
     void terminate ();
-    bool embrace (raddi::connection * source, const raddi::entry * entry, std::size_t size, std::size_t nesting = 0);
+    bool embrace (raddi::connection * source, const raddi::entry * entry, std::size_t size);
     bool assess_proof_requirements (const raddi::entry * entry, const raddi::proof * proof, bool & disconnect);
 
     std::size_t          workers = 0;
@@ -562,12 +562,18 @@ namespace {
     // TODO: move to 'raddi::node::insert' where 'node' will contain database, coordinator, glue functions and options loading
     //  - and only Win32 stuff will remain in node.cpp
 
-    bool embrace (raddi::connection * source, const raddi::entry * entry, std::size_t size, std::size_t nesting) {
-        const bool broadcast = (nesting == 0); // don't broadcast if called as part of detached reordering nesting, already have
+    // admit
+    //  - assessment part of 'embrace', everything before the entry is inserted into database
+    //  - sets 'insert' if the entry is to be inserted, 'top' and 'recent' are then passed to 'embraced'
+    //  - returns false if 'source' is to be disconnected
+    //
+    bool admit (raddi::connection * source, const raddi::entry * entry, std::size_t size, bool broadcast,
+                raddi::db::root & top, bool & recent, bool & insert) {
         const bool old = raddi::older (entry->id.timestamp, raddi::now () - raddi::consensus::max_entry_age_allowed);
-        bool inserted = false;
 
-        raddi::db::root top;
+        recent = false;
+        insert = false;
+
         raddi::db::assessed_level level;
         switch (database->assess (entry, size, &top, &level)) {
 
@@ -617,9 +623,23 @@ namespace {
                         
             case raddi::db::classify:
 
+                // refuse entries that would be removed by next retirement, unless retained by some application
+                //  - see raddi::db::retire and 'database-retention-period' option
+
+                if (database->expired (entry->id.timestamp)) {
+                    const raddi::eid chain [] = { entry->id, top.thread, top.channel };
+                    if (!coordinator->retained.is_subscribed (chain)) {
+                        coordinator->refused.insert (entry->id);
+                        coordinator->detached.reject (entry->id);
+                        raddi::log::data (raddi::component::database, 11, entry->id, entry->id.timestamp,
+                                          database->settings.retention_period);
+                        break;
+                    }
+                }
+
                 // ignore the ones we already processed recently
 
-                if (!(inserted = coordinator->recent.insert (entry->id)))
+                if (!(recent = coordinator->recent.insert (entry->id)))
                     break;
 
                 // additional check against consensus size/proof for non-announcement entries
@@ -712,65 +732,139 @@ namespace {
                 if (source != nullptr) {
                     // TODO: pass to spam-filtering plugins here
                 }
-                    
-                bool exists = false;
-                if (database->insert (entry, size, top, exists)) {
-                    if (exists) {
-                        
-                        // FUTURE FEATURE: this might be 'stream'
-                        //  - TODO: if author is subscribed to or channel allowed or something then save stream content to temp for app to handle
-                        //  - TODO: database->insert will report errors for different content if content comparison is enabled, solve
-                        //  - otherwise ignore duplicates
 
-                    } else {
+                insert = true;
+                break;
+        }
+        return true;
+    }
+
+    // embraced
+    //  - processing of entry that 'admit' passed and that was inserted into database
+    //    (reported as not existing before)
+    //  - returns true if the entry was seen for the first time, its detached descendants can be released then
+    //
+    bool embraced (raddi::connection * source, const raddi::entry * entry, std::size_t size,
+                   const raddi::db::root & top, bool recent, bool broadcast) {
+        const bool old = raddi::older (entry->id.timestamp, raddi::now () - raddi::consensus::max_entry_age_allowed);
 
-                        // remember as recent
-                        //  - if 'insert' fails, we have already seen this one, don't broadcast then
-                        //  - might have been already inserted into 'recent' in 'classify' case above
+        // remember as recent
+        //  - if 'insert' fails, we have already seen this one, don't broadcast then
+        //  - might have been already inserted into 'recent' in 'classify' case of 'admit'
 
-                        if (!inserted) {
-                            inserted = coordinator->recent.insert (entry->id);
-                        }
+        if (!recent) {
+            recent = coordinator->recent.insert (entry->id);
+        }
 
-                        // process further only when seen for the first time
+        // process further only when seen for the first time
+        //  - redistribute to other connections if not old (would be rejected anyway)
+        //  - generaly old entries are comming back only on request
 
-                        if (inserted) {
+        if (recent && broadcast && !old) {
+            auto n = coordinator->broadcast (top, entry, size, source);
 
-                            // redistribute to other connections if not old (would be rejected anyway)
-                            //  - generaly old entries are comming back only on request
+            if (source == nullptr) {
+                raddi::log::event (raddi::component::main, 0x21, entry->id, n);
+            }
+        }
+        return recent;
+    }
 
-                            if (broadcast && !old) {
-                                auto n = coordinator->broadcast (top, entry, size, source);
+    // release
+    //  - processes detached entries whose parent has been inserted just now
+    //  - detached entries have already been validated and broadcasted, see 'admit'
+    //  - 'accept' releases whole chain of descendants iteratively, one generation at a time,
+    //    which is inserted with batched db::insert, see 'database-insert-batch-size' parameter
+    //     - this is where history downloads (arriving unordered) are mostly stored
+    //  - TODO: evaluate for race conditions possibility on parallel insertions and embraces here
+    //
+    bool release (raddi::connection * source, const raddi::eid & parent) {
+        return coordinator->detached.accept (parent, [source] (const std::vector <std::vector <std::uint8_t>> & entries,
+                                                               std::vector <bool> & accepted) {
+            std::vector <raddi::db::insertion> batch;
+            std::vector <std::size_t> positions;
+            std::vector <bool> recents;
 
-                                if (source == nullptr) {
-                                    raddi::log::event (raddi::component::main, 0x21, entry->id, n);
-                                }
-                            }
+            batch.reserve (entries.size ());
+            positions.reserve (entries.size ());
+            recents.reserve (entries.size ());
 
-                            // process detached entries whose parent has been inserted just now
-                            //  - detached entries have already been validated
-                            //  - TODO: evaluate for race conditions possibility on parallel insertions and embraces here:
+            for (std::size_t i = 0; i != entries.size (); ++i) {
+                const auto entry = reinterpret_cast <const raddi::entry *> (entries [i].data ());
+                const auto size = entries [i].size ();
 
-                            return coordinator->detached.accept (entry->id, [source, nesting] (const std::uint8_t * data, std::size_t size) {
-                                auto entry = reinterpret_cast <const raddi::entry *> (data);
-                                raddi::log::note (raddi::component::database, 6, entry->id, entry->parent);
-                                return embrace (source, entry, size, nesting + 1);
-                            });
-                        }
+                raddi::log::note (raddi::component::database, 6, entry->id, entry->parent);
+
+                raddi::db::insertion item;
+                bool recent;
+                bool insert;
+
+                if (!admit (source, entry, size, false, item.top, recent, insert))
+                    return false;
+
+                if (insert) {
+                    item.entry = entry;
+                    item.size = size;
+
+                    batch.push_back (item);
+                    positions.push_back (i);
+                    recents.push_back (recent);
+                }
+            }
+
+            if (!batch.empty ()) {
+                database->insert (batch.data (), batch.size ());
+
+                for (std::size_t i = 0; i != batch.size (); ++i) {
+                    if (batch [i].inserted) {
+                        accepted [positions [i]] = embraced (source, batch [i].entry, batch [i].size, batch [i].top, recents [i], false);
+                    } else
+                    if (!batch [i].exists) {
+                        SetEvent (::optimize); // see 'embrace'
                     }
-                } else {
-                    // basically disk write problem or not enough memory
-                    // database->insert also checks for valid entry size, but that should've been verified by now
+                }
+            }
+            return true;
+        });
+    }
 
-                    // TODO: something like overview.set (L"fail...", 1);
+    // embrace
+    //  - processes single entry received from network ('source') or local application (nullptr)
+    //  - returns false if 'source' is to be disconnected
+    //
+    bool embrace (raddi::connection * source, const raddi::entry * entry, std::size_t size) {
+        raddi::db::root top;
+        bool recent;
+        bool insert;
 
-                    SetEvent (::optimize);
+        if (!admit (source, entry, size, true, top, recent, insert))
+            return false;
+
+        if (insert) {
+            bool exists = false;
+            if (database->insert (entry, size, top, exists)) {
+                if (exists) {
+
+                    // FUTURE FEATURE: this might be 'stream'
+                    //  - TODO: if author is subscribed to or channel allowed or something then save stream content to temp for app to handle
+                    //  - TODO: database->insert will report errors for different content if content comparison is enabled, solve
+                    //  - otherwise ignore duplicates
+
+                } else {
+                    if (embraced (source, entry, size, top, recent, true))
+                        return release (source, entry->id);
                 }
-                break;
+            } else {
+                // basically disk write problem or not enough memory
+                // database->insert also checks for valid entry size, but that should've been verified by now
+
+                // TODO: something like overview.set (L"fail...", 1);
+
+                SetEvent (::optimize);
+            }
         }
         return true;
     }
-
     std::wstring DetermineDatabaseDirectory (raddi::log::scope scope, const wchar_t * option_database) {
 
         wchar_t path [32768];
@@ -979,6 +1073,16 @@ namespace {
             option (argc, argw, L"database-backtrack-granularity", database.settings.backtrack_granularity);
             option (argc, argw, L"database-reinsertion-validation", database.settings.reinsertion_validation);
             option (argc, argw, L"database-xor-mask-size", database.settings.xor_mask_size);
+            option (argc, argw, L"database-memory-mapped-shards", database.settings.memory_mapped_shards);
+            option (argc, argw, L"database-compaction-threshold", database.settings.compaction_threshold);
+            option (argc, argw, L"database-bloom-filter-bits", database.settings.bloom_filter_bits);
+            option (argc, argw, L"database-warm-up-threads", database.settings.warm_up_threads);
+            option (argc, argw, L"database-retention-period", database.settings.retention_period);
+            option (argc, argw, L"database-memory-budget", database.settings.memory_budget);
+            option (argc, argw, L"database-journal", database.settings.write_ahead_journal);
+            option (argc, argw, L"database-insert-batch-size", database.settings.insert_batch_size);
+
+            database.warm_up ();
 
             ::database = &database;
         } else {
@@ -1329,6 +1433,7 @@ namespace {
         SetThreadPriority (GetCurrentThread (), THREAD_PRIORITY_BELOW_NORMAL);
 
         bool initial_optimize = true;
+        bool low_memory = false;
         bool running = true;
         do {
             switch (WaitForMultipleObjects (sizeof events / sizeof events [0], events, FALSE, 1000)) {
@@ -1371,6 +1476,14 @@ namespace {
                     GetLocalTime (&st);
                     raddi::log::event (0x03, st);
                     ScheduleTimerToLocalMidnight (events [2], 10'000'0);
+
+                    // retirement of old data
+                    //  - whole chain of the entry is checked, applications retain either entries, threads or channels
+
+                    database.retire ([&coordinator] (const raddi::eid & id, const raddi::db::root & top) {
+                        const raddi::eid chain [] = { id, top.thread, top.channel };
+                        return coordinator.retained.is_subscribed (chain);
+                    });
                 } break;
 
                 // keep-alive
@@ -1393,11 +1506,13 @@ namespace {
                     if (events [4] == lowmemorynotification) {
                         events [4] = lowmemorynotificationtimer;
                         ScheduleWaitableTimer (lowmemorynotificationtimer, 20 * 10'000'000LL); // 20s
+                        low_memory = true;
                         
                         [[ fallthrough ]];
                         
                 // optimize
-                //  - low memory state hit in worker or detected by service handler
+                //  - low memory state hit in worker or detected by service handler, or requested from console
+                //  - only actual low memory notification reduces database memory budget (see db::pressure)
                 // 
                 case WAIT_OBJECT_0 + 5:
                         if (!initial_optimize) {
@@ -1408,7 +1523,12 @@ namespace {
                         }
 
                         CompactServerMemory ();
-                        database.optimize (true);
+                        if (low_memory) {
+                            database.pressure ();
+                            raddi::proof::trim ();
+                        } else {
+                            database.optimize (true);
+                        }
                         database.flush ();
                         coordinator.optimize ();
 
@@ -1417,6 +1537,7 @@ namespace {
                         }
                         SetProcessWorkingSetSize (GetCurrentProcess (), (SIZE_T) -1, (SIZE_T) -1);
                         initial_optimize = false;
+                        low_memory = false;
                     } else {
                         events [4] = lowmemorynotification;
                     }